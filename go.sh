@@ -28,7 +28,7 @@ test    \t - Re-build and run JADE++ on a set of test functions.
 single  \t - Re-build and run JADE++ on a single test function.
 Possible enviroment parameters:\n
 \n
-JADE_MPI_size   \t- total number of MPI processes.\n
+JADE_MPI_size   \t- total number of MPI processes (1 runs without mpirun).\n
 JADE_MPI_nodes  \t- total number of MPI nodes for cluster enviroment.\n
 \n
 In the case of enviroment parameters are not (or set with value 'unset')\n
@@ -86,7 +86,7 @@ fi
 
 #jade_bin="run-optimize-feed-cloak"
 #jade_bin="run-optimize-absorber-TiN"
-jade_bin="run-optimize-alu"
+jade_bin="run-layered-acoustics"
 #jade_bin="run-optimize-absorber-TiN-bi"
 #jade_bin="run-optimize-ideal-bulk"
 
@@ -403,7 +403,12 @@ function RunJADE {
     else
         echo "(1) Nodes 1  procs $JADE_MPI_size"
         #time mpirun -np $JADE_MPI_size $MPI_options ./$jade_bin #jade.config
-        mpirun -np $JADE_MPI_size $MPI_options ./$jade_bin #jade.config
+        if [[ $JADE_MPI_size = 1 ]]; then
+            # Single process runs without MPI launcher and MPI startup.
+            ./$jade_bin
+        else
+            mpirun -np $JADE_MPI_size $MPI_options ./$jade_bin #jade.config
+        fi
     fi    
     cd $path_tmp
 }  # end of RunJADE
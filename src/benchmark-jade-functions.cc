@@ -0,0 +1,75 @@
+///
+/// @file   benchmark-jade-functions.cc
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2013 Ladutenko Konstantin
+/// @section LICENSE
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+
+/// @brief Full optimization of standard test functions for several
+/// population sizes and dimensions. Each MPI process does an
+/// independent run, printed are wall time of the slowest run and
+/// mean (stddev) of the best fitness found by all runs.
+#include <mpi.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "./jade.h"
+#include "./benchmark-jade.h"
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  const long kPopulations[] = {50, 100, 200};                          // NOLINT
+  // Generations are increased with dimension.
+  const long kDimensions[] = {10, 30, 100};                            // NOLINT
+  const long kGenerations[] = {1000, 2000, 3000};                      // NOLINT
+  if (rank == 0)
+    printf("%-10s %4s %4s %6s %9s %9s %9s %4s\n", "function", "D", "NP",
+           "gen", "time,s", "mean", "stddev", "runs");
+  for (const auto &test : benchmark::kTestFunctions) {
+    for (int d = 0; d < 3; ++d) {
+      for (long population : kPopulations) {                           // NOLINT
+        jade::SubPopulation sub_population;
+        sub_population.FitnessFunction = test.function;
+        sub_population.Init(population, kDimensions[d]);
+        sub_population.SetDistributionLevel(0);
+        sub_population.SetTargetToMinimum();
+        sub_population.SetTotalGenerationsMax(kGenerations[d]);
+        sub_population.SetAllBounds(-test.bound, test.bound);
+        sub_population.SetSeed(rank + 1);
+        sub_population.SwitchOffOutput();
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        sub_population.RunOptimization();
+        double time = MPI_Wtime() - start, max_time = 0.0;
+        MPI_Reduce(&time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0,
+                   MPI_COMM_WORLD);
+        std::vector<double> best = sub_population.GetFinalFitness();
+        if (rank != 0) continue;
+        double mean = 0.0, sigma = 0.0;
+        for (double value : best) mean += value;
+        mean /= best.size();
+        for (double value : best) sigma += (value - mean) * (value - mean);
+        sigma = std::sqrt(sigma / best.size());
+        printf("%-10s %4li %4li %6li %9.3f %9.2e %9.2e %4lu\n", test.name,
+               kDimensions[d], population, kGenerations[d], max_time, mean,
+               sigma, best.size());
+      }
+    }
+  }
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,124 @@
+///
+/// @file   benchmark-jade-scaling.cc
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2013 Ladutenko Konstantin
+/// @section LICENSE
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+
+/// @brief MPI scaling of JADE++ distribution levels 1, 2 and 3.
+///
+/// Usage: run-benchmark-scaling [strong|weak] [cost] [threads] [ranks]
+///
+/// Strong scaling keeps total population fixed, weak scaling keeps
+/// population per MPI process fixed. Fitness is Rastrigin function
+/// evaluated cost times to emulate an expensive objective. A single
+/// line is printed for each level, so a log of
+///   for n in 1 2 4 8; do mpirun -np $n ./run-benchmark-scaling weak; done
+/// gives parallel efficiency time(1)/time(n) for weak scaling and
+/// time(1)/(n*time(n)) for strong scaling. If ranks is positive, the
+/// levels are run by ranks threads of a single process with
+/// ThreadCommunicator instead of MPI processes.
+#include <mpi.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./jade.h"
+#include "./benchmark-jade.h"
+long cost_ = 100;                                                      // NOLINT
+double ExpensiveFitness(const std::vector<double> &x) {
+  double fitness = 0.0;
+  for (long i = 0; i < cost_; ++i) fitness = benchmark::Rastrigin(x);  // NOLINT
+  return fitness;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Returns time of the slowest rank.
+double RunLevel(int level, long population, int threads,              // NOLINT
+                std::shared_ptr<jade::Communicator> communicator,
+                double *best) {
+  const long dimension = 30, generations = 200;                        // NOLINT
+  jade::SubPopulation sub_population;
+  sub_population.SetCommunicator(communicator);
+  sub_population.FitnessFunction = &ExpensiveFitness;
+  // Each island has its own population.
+  long size = level == 2 ? population / communicator->Size()         // NOLINT
+      : population;
+  sub_population.Init(size, dimension);
+  sub_population.SetDistributionLevel(level);
+  sub_population.SetNumberOfThreads(threads);
+  sub_population.SetTargetToMinimum();
+  sub_population.SetTotalGenerationsMax(generations);
+  sub_population.SetAllBounds(-5.12, 5.12);
+  sub_population.SetSeed(1);
+  sub_population.SwitchOffOutput();
+  communicator->Barrier();
+  double start = jade::Communicator::GetTime();
+  sub_population.RunOptimization();
+  double time = jade::Communicator::GetTime() - start, max_time = 0.0;
+  communicator->AllReduceMax(&time, 1, &max_time);
+  sub_population.GetBest(best);
+  return max_time;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  int rank, processes;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &processes);
+  const bool isWeak = argc > 1 && std::string(argv[1]) == "weak";
+  if (argc > 2) cost_ = std::atol(argv[2]);
+  const int threads = argc > 3 ? std::atoi(argv[3]) : 1;
+  const int ranks = argc > 4 ? std::atoi(argv[4]) : 0;
+  if (ranks > 0) processes = ranks;
+  const long generations = 200;                                        // NOLINT
+  const long population_per_process = 100;                             // NOLINT
+  const long population = isWeak ? population_per_process * processes  // NOLINT
+      : population_per_process * 8;
+  if (rank == 0)
+    printf("%-6s %5s %9s %7s %6s %9s %12s %9s\n", "mode", "level",
+           "processes", "threads", "NP", "time,s", "evaluations/s", "best");
+  for (int level = 1; level <= 3; ++level) {
+    double max_time = 0.0, best = 0.0;
+    if (ranks > 0) {
+      auto group = jade::ThreadCommunicator::CreateGroup(ranks);
+      std::vector<std::thread> rank_threads;
+      std::vector<double> rank_best(ranks);
+      for (int r = 0; r < ranks; ++r)
+        rank_threads.emplace_back([&, r]() {
+            double time = RunLevel(level, population, threads, group[r],
+                                   &rank_best[r]);
+            if (r == 0) max_time = time;
+          });
+      for (auto &rank_thread : rank_threads) rank_thread.join();
+      best = rank_best[0];
+    } else {
+      max_time = RunLevel(level, population, threads,
+                          std::make_shared<jade::MpiCommunicator>(), &best);
+    }
+    if (rank == 0)
+      printf("%-6s %5i %9i %7i %6li %9.3f %12.4g %9.2e\n",
+             isWeak ? "weak" : "strong", level, processes, threads,
+             population, max_time, population * generations / max_time, best);
+  }
+  MPI_Finalize();
+  return 0;
+}
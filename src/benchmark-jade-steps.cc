@@ -0,0 +1,123 @@
+///
+/// @file   benchmark-jade-steps.cc
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2013 Ladutenko Konstantin
+/// @section LICENSE
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+
+/// @brief Microbenchmark of single generation steps of JADE++ with a
+/// trivial fitness function. Should be run with one MPI process,
+/// printed time is in microseconds per generation.
+#include <mpi.h>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "./jade.h"
+#include "./benchmark-jade.h"
+namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  class SubPopulationBenchmark {
+   public:
+    enum Step {kSetCRiFi = 0, kMutation, kCrossover, kEvaluate, kSelection,
+               kArchive, kSteps};
+    /// @brief Prepare population with a single generation, so archive,
+    /// sorting and adaptors are in use.
+    explicit SubPopulationBenchmark(SubPopulation *population)
+        : population_(*population) {
+      population_.SetTotalGenerationsMax(1);
+      population_.RunOptimization();
+    }
+    /// @brief Repeat steps of the same generation, time of each step
+    /// is summed to time[step].
+    void Run(long repeats, double *time) {                             // NOLINT
+      SubPopulation &p = population_;
+      for (long r = 0; r < repeats; ++r) {                             // NOLINT
+        double start = MPI_Wtime();
+        p.SetCRiFi();
+        double stop = MPI_Wtime();
+        time[kSetCRiFi] += stop - start;
+        start = stop;
+        for (long i = p.index_first_; i < p.index_last_; ++i)
+          p.Mutation(i, &p.trial_vectors_u_[i - p.index_first_].front());
+        stop = MPI_Wtime();
+        time[kMutation] += stop - start;
+        start = stop;
+        for (long i = p.index_first_; i < p.index_last_; ++i)
+          p.Crossover(i, &p.trial_vectors_u_[i - p.index_first_].front());
+        stop = MPI_Wtime();
+        time[kCrossover] += stop - start;
+        start = stop;
+        p.EvaluateBatch(p.trial_vectors_u_,
+                        &p.evaluated_fitness_for_trial_vectors_);
+        stop = MPI_Wtime();
+        time[kEvaluate] += stop - start;
+        p.successful_mutation_parameters_S_F_.clear();
+        p.successful_crossover_parameters_S_CR_.clear();
+        start = MPI_Wtime();
+        for (long i = p.index_first_; i < p.index_last_; ++i) p.Selection(i);
+        stop = MPI_Wtime();
+        time[kSelection] += stop - start;
+        start = stop;
+        p.ArchiveCleanUp();
+        time[kArchive] += MPI_Wtime() - start;
+      }
+    }
+   private:
+    SubPopulation &population_;
+  };  // end of class SubPopulationBenchmark
+}  // end of namespace jade
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  const long kPopulations[] = {50, 200, 1000};                         // NOLINT
+  const long kDimensions[] = {10, 30, 100};                            // NOLINT
+  if (rank == 0)
+    printf("%6s %4s %9s %9s %9s %9s %9s %9s\n", "NP", "D", "SetCRiFi",
+           "Mutation", "Crossover", "Evaluate", "Selection", "Archive");
+  for (long population : kPopulations) {                               // NOLINT
+    for (long dimension : kDimensions) {                               // NOLINT
+      jade::SubPopulation sub_population;
+      sub_population.FitnessFunction = &benchmark::Sphere;
+      sub_population.Init(population, dimension);
+      sub_population.SetDistributionLevel(0);
+      sub_population.SetTargetToMinimum();
+      sub_population.SetAllBounds(-100.0, 100.0);
+      sub_population.SetSeed(1);
+      sub_population.SwitchOffOutput();
+      jade::SubPopulationBenchmark steps(&sub_population);
+      // Same amount of work for each size.
+      const long repeats = std::max(10L, 20000000L / (population * dimension)); // NOLINT
+      // Warm up caches before timing.
+      std::vector<double> time(jade::SubPopulationBenchmark::kSteps, 0.0);
+      steps.Run(1, &time.front());
+      std::fill(time.begin(), time.end(), 0.0);
+      steps.Run(repeats, &time.front());
+      if (rank == 0) {
+        printf("%6li %4li", population, dimension);
+        for (double t : time) printf(" %9.2f", t / repeats * 1e6);
+        printf("\n");
+      }
+    }
+  }
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef SRC_BENCHMARK_JADE_H_
+#define SRC_BENCHMARK_JADE_H_
+///
+/// @file   benchmark-jade.h
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2013 Ladutenko Konstantin
+/// @section LICENSE
+/// This file is part of JADE++.
+///
+/// JADE++ is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// JADE++ is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with JADE++.  If not, see <http://www.gnu.org/licenses/>.
+
+/// @brief Standard test functions shared by JADE++ benchmarks.
+#include <cmath>
+#include <vector>
+namespace benchmark {
+  const double kPi = 3.14159265358979323846;
+  // ********************************************************************** //
+  /// @brief Unimodal, minimum 0 at x = 0, bounds (-100, 100). It is
+  /// cheap enough to measure the cost of the optimizer itself.
+  inline double Sphere(const std::vector<double> &x) {
+    double sum = 0.0;
+    for (auto value : x) sum += value * value;
+    return sum;
+  }
+  // ********************************************************************** //
+  /// @brief Multimodal, minimum 0 at x = 0, bounds (-5.12, 5.12).
+  inline double Rastrigin(const std::vector<double> &x) {
+    double sum = 10.0 * x.size();
+    for (auto value : x)
+      sum += value * value - 10.0 * std::cos(2.0 * kPi * value);
+    return sum;
+  }
+  // ********************************************************************** //
+  /// @brief Narrow curved valley, minimum 0 at x = (1, ..., 1),
+  /// bounds (-30, 30).
+  inline double Rosenbrock(const std::vector<double> &x) {
+    double sum = 0.0;
+    for (unsigned int i = 0; i + 1 < x.size(); ++i)
+      sum += 100.0 * (x[i+1] - x[i]*x[i]) * (x[i+1] - x[i]*x[i])
+          + (x[i] - 1.0) * (x[i] - 1.0);
+    return sum;
+  }
+  // ********************************************************************** //
+  struct TestFunction {
+    const char *name;
+    double (*function)(const std::vector<double> &x);
+    double bound;
+  };
+  const TestFunction kTestFunctions[] = {
+    {"sphere", Sphere, 100.0},
+    {"rastrigin", Rastrigin, 5.12},
+    {"rosenbrock", Rosenbrock, 30.0}
+  };
+}  // end of namespace benchmark
+#endif  // SRC_BENCHMARK_JADE_H_
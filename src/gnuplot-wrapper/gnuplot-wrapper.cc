@@ -60,8 +60,12 @@ namespace gnuplot{
       // #set linestyle 1 lt 2 lw 3
     plt_format += "set title \"" + plot_name_ + "\"\n"
       +"plot \\\n";
+    std::string data_file = isBinary_
+      ? "\"" + plot_name_ + ".bin\" binary format='%"
+        + std::to_string(column_names_.size()) + "double'"
+      : "\"" + plot_name_ + ".dat\"";
     for (int i = 1; i < column_names_.size(); ++i)
-      plt_format += "\"" + plot_name_ + ".dat\" using 1:"
+      plt_format += data_file + " using 1:"
         + std::to_string(i+1) + " title '" +
         column_names_[i] + "' " +
         plot_draw_style_ +",\\\n";
@@ -85,19 +89,43 @@ namespace gnuplot{
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  std::string GnuplotWrapper::GetDataHeader() {
+    std::string header_line = "#";
+    for (auto name : column_names_) header_line += name + "\t";
+    header_line.push_back('\n');
+    header_line += "# "+ plot_name_ + "\n";
+    return header_line;
+  }  // end of std::string GnuplotWrapper::GetDataHeader()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::string GnuplotWrapper::GetDataRow(const std::vector<double> &row) {
+    std::string line;
+    char cell_text[32];
+    for (auto cell : row) {
+      snprintf(cell_text, sizeof(cell_text), "%.19g\t", cell);
+      line += cell_text;
+    }
+    line.push_back('\n');
+    return line;
+  }  // end of std::string GnuplotWrapper::GetDataRow()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void GnuplotWrapper::OpenStream() {
+    stream_.Open(plot_name_ + (isBinary_ ? ".bin" : ".dat"));
+    if (!isBinary_) stream_.Write(GetDataHeader());
+  }  // end of void GnuplotWrapper::OpenStream()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   void GnuplotWrapper::PrintDataFile() {
     FILE *fp;
     std::string fname = plot_name_ + ".dat";
     fp = fopen(fname.c_str(), "w");
-    std::string header_line = "#";
-    for (auto name : column_names_) header_line += name + "\t";
-    header_line.push_back('\n');
-    fprintf(fp, "%s", header_line.c_str());
-    header_line = "# "+ plot_name_ + "\n";
-    fprintf(fp, "%s", header_line.c_str());    
+    fprintf(fp, "%s", GetDataHeader().c_str());
     for (auto row : data_) {
-      for (auto cell : row) fprintf(fp, "%.19g\t", cell);
-      fprintf(fp, "\n");
+      fprintf(fp, "%s", GetDataRow(row).c_str());
     }  // end of for each row
     fclose(fp);
   }  // end of void GnuplotWrapper::PrintDataFile()
@@ -109,7 +137,14 @@ namespace gnuplot{
     for (auto row : data_)
       if (number_or_columns != row.size())
         throw std::invalid_argument("All rows should be the same size!");
-    PrintDataFile();
+    if (isStreaming_) {
+      // Data file is created even without rows.
+      if (!stream_.IsOpen()) OpenStream();
+      if (!stream_.Close())
+        throw std::runtime_error("Can not write data of " + plot_name_);
+    } else {
+      PrintDataFile();
+    }
     PrintPlotFile();
     PrintShellFile();
   }
@@ -117,7 +152,15 @@ namespace gnuplot{
   // ********************************************************************** //
   // ********************************************************************** //
   void GnuplotWrapper::AddMultiPoint(std::vector<double> point) {
-    data_.push_back(point);
+    if (!isStreaming_) {
+      data_.push_back(point);
+      return;
+    }
+    if (!stream_.IsOpen()) OpenStream();
+    if (point.size() != column_names_.size())
+      throw std::invalid_argument("All rows should be the same size!");
+    if (isBinary_) stream_.Write(point);
+    else stream_.Write(GetDataRow(point));
   }  // end of void GnuplotWrapper::AddMultiPoint(std::vector<double> point)
   // ********************************************************************** //
   // ********************************************************************** //
@@ -26,6 +26,7 @@
 ///
 #include <vector>
 #include <string>
+#include "../stream-writer/stream-writer.h"
 namespace gnuplot {
   class GnuplotWrapper {
    public:
@@ -37,9 +38,17 @@ namespace gnuplot {
     void SetYRange(std::vector<double> range) {y_range_ = range;};
     void AddMultiPoint(std::vector<double> point);
     void AddColumnName(std::string name) {column_names_.push_back(name);};
+    /// Rows added after this call are not kept in memory, they are
+    /// appended by a background thread to plot_name_.dat as text or
+    /// to plot_name_.bin as doubles (plotted with gnuplot binary
+    /// format). Plot and column names should be set before.
+    void SetStreaming(bool isBinary) {isStreaming_ = true; isBinary_ = isBinary;};
     void MakeOutput();
     
    private:
+    std::string GetDataHeader();
+    std::string GetDataRow(const std::vector<double> &row);
+    void OpenStream();
     void PrintDataFile();
     void PrintPlotFile();
     void PrintShellFile();
@@ -55,6 +64,9 @@ namespace gnuplot {
     std::string plot_draw_style_ = "w l lw 2";
     std::vector< std::string> column_names_;
     std::vector< std::vector<double> > data_;
+    bool isStreaming_ = false;
+    bool isBinary_ = false;
+    stream_writer::StreamWriter stream_;
   };  // end of class GnuplotWRapper
 }  // end of namespace gnuplot
 #endif  // SRC_GNUPLOT_WRAPPER_GNUPLOT_WRAPPER_H_
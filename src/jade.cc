@@ -29,46 +29,917 @@
 /// Evolution' in H. Deng et al. (Eds.): AICI 2011, Part II, LNAI
 /// 7003, pp. 34–41, 2011
 #include "./jade.h"
-#include <mpi.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
 #include <random>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
 #include <cmath>
 #include <algorithm>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 #include <map>
 #include <iterator>
+#include <numeric>
 #include <string>
 #include <vector>
 namespace jade {
   /// @todo Replace all simple kError returns with something meangfull.
+  const int kMigrationTag = 1;
+  /// Messages of asynchronous model.
+  const int kTrialTag = 2, kResultTag = 3, kStopTag = 4;
+  const double kPi = 3.14159265358979323846;
+  /// @brief Checkpoint file starts with this header, it is followed
+  /// by current population (NP*D), fitness (NP), archive
+  /// (archive_size*D) and text states of mt19937_64 generators.
+  struct CheckpointHeader {
+    char magic[8];
+    std::int64_t dimension, subpopulation, archive_size, generation;
+    double mu_F, mu_CR;
+    std::uint64_t random_batch_state[3];
+    std::int64_t generator_state_size, migration_generator_state_size;
+  };
+  const char kCheckpointMagic[8] = {'J', 'A', 'D', 'E', 'C', 'K', 'P', '1'};
+  /// @brief Adds its life time to given phase time.
+  class PhaseTimer {
+   public:
+    explicit PhaseTimer(double *time)
+        : time_(time), start_(Communicator::GetTime()) {}
+    ~PhaseTimer() {*time_ += Communicator::GetTime() - start_;}
+   private:
+    double *time_;
+    double start_;
+  };
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  ThreadPool::~ThreadPool() {
+    Stop();
+  }  // end of ThreadPool::~ThreadPool()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadPool::Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      isStop_ = true;
+    }
+    start_.notify_all();
+    for (auto &worker : workers_) worker.join();
+    workers_.clear();
+    isStop_ = false;
+  }  // end of void ThreadPool::Stop()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadPool::Resize(int threads) {
+    if (threads < 1)
+      throw std::invalid_argument("You should set threads > 0!");
+    Stop();
+    blocks_.reset(new Block[threads]);
+    for (int worker = 1; worker < threads; ++worker)
+      workers_.emplace_back(&ThreadPool::WorkerLoop, this, worker);
+  }  // end of void ThreadPool::Resize(int threads)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadPool::WorkerLoop(int worker) {
+    long batch_done = 0;                                              // NOLINT
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_.wait(lock, [&]{return isStop_ || batch_ != batch_done;});
+        if (isStop_) return;
+        batch_done = batch_;
+      }
+      Execute(worker);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --running_;
+      }
+      finish_.notify_one();
+    }  // end of waiting for batches
+  }  // end of void ThreadPool::WorkerLoop(int worker)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadPool::Execute(int worker) {
+    const int threads = Size();
+    // Own block first, than steal from the others.
+    for (int shift = 0; shift < threads; ++shift) {
+      Block &block = blocks_[(worker + shift) % threads];
+      while (true) {
+        const long n = block.next.fetch_add(1);                        // NOLINT
+        if (n >= block.end) break;
+        try {
+          (*task_)(n);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!exception_) exception_ = std::current_exception();
+        }
+      }  // end of processing block
+    }  // end of for all blocks
+  }  // end of void ThreadPool::Execute(int worker)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadPool::Run(long tasks, const std::function<void(long)> &task) { // NOLINT
+    const int threads = Size();
+    for (int worker = 0; worker < threads; ++worker) {
+      blocks_[worker].next = tasks * worker / threads;
+      blocks_[worker].end = tasks * (worker + 1) / threads;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      exception_ = nullptr;
+      running_ = threads - 1;
+      ++batch_;
+    }
+    start_.notify_all();
+    Execute(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    finish_.wait(lock, [&]{return running_ == 0;});
+    task_ = nullptr;
+    if (exception_) std::rethrow_exception(exception_);
+  }  // end of void ThreadPool::Run()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  PopulationMatrix& PopulationMatrix::operator=(const PopulationMatrix &other) {
+    if (this == &other) return *this;
+    if (rows_ != other.rows_ || columns_ != other.columns_)
+      Resize(other.rows_, other.columns_);
+    if (rows_ > 0)
+      std::copy(other[0], other[0] + rows_ * stride_, (*this)[0]);
+    return *this;
+  }  // end of PopulationMatrix::operator=()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void PopulationMatrix::Resize(long rows, long columns) {             // NOLINT
+    rows_ = rows;
+    columns_ = columns;
+    stride_ = (columns + kPadding - 1) / kPadding * kPadding;
+    storage_.assign(rows_ * stride_ + kPadding, 0.0);
+    const long misalignment = (reinterpret_cast<std::uintptr_t>(      // NOLINT
+        storage_.data()) / sizeof(double)) % kPadding;
+    offset_ = misalignment == 0 ? 0 : kPadding - misalignment;
+  }  // end of void PopulationMatrix::Resize()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void PopulationMatrix::Swap(PopulationMatrix &other) {
+    // Buffers are not moved, so alignment offsets stay valid.
+    storage_.swap(other.storage_);
+    std::swap(offset_, other.offset_);
+    std::swap(rows_, other.rows_);
+    std::swap(columns_, other.columns_);
+    std::swap(stride_, other.stride_);
+  }  // end of void PopulationMatrix::Swap()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CounterRandom::Seed(std::uint64_t seed, std::uint64_t stream) {
+    key_[0] = static_cast<std::uint32_t>(seed);
+    key_[1] = static_cast<std::uint32_t>(seed >> 32);
+    stream_[0] = static_cast<std::uint32_t>(stream);
+    stream_[1] = static_cast<std::uint32_t>(stream >> 32);
+    counter_ = 0;
+  }  // end of void CounterRandom::Seed()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CounterRandom::FillUniform(double *uniform, long size) {      // NOLINT
+    const std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    const double to_unit = 1.0 / 9007199254740992.0;  // 2^-53
+    const long blocks = (size + 1) / 2;                                // NOLINT
+    // Iterations are independent, each block gives two doubles.
+    for (long b = 0; b < blocks; ++b) {                                // NOLINT
+      const std::uint64_t counter = counter_ + b;
+      std::uint32_t c0 = static_cast<std::uint32_t>(counter);
+      std::uint32_t c1 = static_cast<std::uint32_t>(counter >> 32);
+      std::uint32_t c2 = stream_[0], c3 = stream_[1];
+      std::uint32_t k0 = key_[0], k1 = key_[1];
+      for (int round = 0; round < 10; ++round) {
+        const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * c0;
+        const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * c2;
+        c0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        c1 = static_cast<std::uint32_t>(p1);
+        c2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c3 = static_cast<std::uint32_t>(p0);
+        k0 += W0;
+        k1 += W1;
+      }  // end of Philox rounds
+      const std::uint64_t r0 = (static_cast<std::uint64_t>(c0) << 32) | c1;
+      const std::uint64_t r1 = (static_cast<std::uint64_t>(c2) << 32) | c3;
+      uniform[2 * b] = (r0 >> 11) * to_unit;
+      if (2 * b + 1 < size) uniform[2 * b + 1] = (r1 >> 11) * to_unit;
+    }  // end of for all blocks
+    counter_ += blocks;
+  }  // end of void CounterRandom::FillUniform()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CounterRandom::GetState(std::uint64_t state[3]) const {
+    state[0] = (static_cast<std::uint64_t>(key_[1]) << 32) | key_[0];
+    state[1] = (static_cast<std::uint64_t>(stream_[1]) << 32) | stream_[0];
+    state[2] = counter_;
+  }  // end of void CounterRandom::GetState()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CounterRandom::SetState(const std::uint64_t state[3]) {
+    Seed(state[0], state[1]);
+    counter_ = state[2];
+  }  // end of void CounterRandom::SetState()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  double CounterRandom::Uniform() {
+    double uniform;
+    FillUniform(&uniform, 1);
+    return uniform;
+  }  // end of double CounterRandom::Uniform()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// SplitMix64 finalizer, used to hash quantized vectors.
+  inline std::uint64_t MixBits(std::uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+  }
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void FitnessCache::Init(long capacity, long dimension,             // NOLINT
+                          double resolution) {
+    if (capacity < 1 || dimension < 1 || !(resolution > 0.0))
+      throw std::invalid_argument("Wrong fitness cache size!");
+    capacity_ = kProbe;
+    while (capacity_ < capacity) capacity_ *= 2;
+    dimension_ = dimension;
+    resolution_ = resolution;
+    keys_.assign(capacity_ * dimension_, 0);
+    key_.assign(dimension_, 0);
+    fitness_.assign(capacity_, 0.0);
+    hash_.resize(capacity_);
+    reference_.resize(capacity_);
+    Clear();
+  }  // end of void FitnessCache::Init()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void FitnessCache::Clear() {
+    std::fill(hash_.begin(), hash_.end(), 0);
+    std::fill(reference_.begin(), reference_.end(), 0);
+    hits_ = 0;
+    misses_ = 0;
+  }  // end of void FitnessCache::Clear()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  int SubPopulation::Selection(std::vector<double> crossover_u, long i)  {
-    bool is_evaluated = false;
-    double f_current = 0.0;
-    for (auto f : evaluated_fitness_for_current_vectors_) {
-      if (f.second == i) {
-        f_current = f.first;
-        is_evaluated = true;
+  std::uint64_t FitnessCache::Quantize(const double *x) {
+    std::uint64_t hash = 0x9E3779B97F4A7C15ULL;
+    for (long i = 0; i < dimension_; ++i) {                            // NOLINT
+      key_[i] = std::llround(x[i] / resolution_);
+      hash = MixBits(hash ^ static_cast<std::uint64_t>(key_[i]));
+    }
+    return hash == 0 ? 1 : hash;
+  }  // end of std::uint64_t FitnessCache::Quantize()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool FitnessCache::IsKeyInSlot(long slot) const {                    // NOLINT
+    return std::equal(key_.begin(), key_.end(),
+                      keys_.begin() + slot * dimension_);
+  }  // end of bool FitnessCache::IsKeyInSlot()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool FitnessCache::Find(const std::vector<double> &x, double *fitness) {
+    const std::uint64_t hash = Quantize(x.data());
+    const long mask = capacity_ - 1;                                   // NOLINT
+    // Slots are never emptied, so the key can not be after empty slot.
+    for (long i = 0; i < kProbe; ++i) {                                // NOLINT
+      const long slot = (hash + i) & mask;                             // NOLINT
+      if (hash_[slot] == 0) break;
+      if (hash_[slot] == hash && IsKeyInSlot(slot)) {
+        reference_[slot] = 1;
+        *fitness = fitness_[slot];
+        ++hits_;
+        return true;
       }
-    }  // end of searching of pre-evaluated fitness for current individual
-    if (!is_evaluated) error_status_ = kError;
-    double f_best = evaluated_fitness_for_current_vectors_.front().first;
-    double f_crossover_u = FitnessFunction(crossover_u);
+    }
+    ++misses_;
+    return false;
+  }  // end of bool FitnessCache::Find()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void FitnessCache::Insert(const double *x, double fitness) {
+    const std::uint64_t hash = Quantize(x);
+    const long mask = capacity_ - 1;                                   // NOLINT
+    long victim = -1;                                                  // NOLINT
+    for (long i = 0; i < kProbe && victim < 0; ++i) {                  // NOLINT
+      const long slot = (hash + i) & mask;                             // NOLINT
+      if (hash_[slot] == 0 || (hash_[slot] == hash && IsKeyInSlot(slot)))
+        victim = slot;
+    }
+    // CLOCK over probed slots: entry that was found since the last
+    // sweep gets a second chance, the first one without it is evicted.
+    for (long i = 0; victim < 0; i = (i + 1) % kProbe) {               // NOLINT
+      const long slot = (hash + i) & mask;                             // NOLINT
+      if (reference_[slot]) reference_[slot] = 0;
+      else victim = slot;
+    }
+    hash_[victim] = hash;
+    reference_[victim] = 0;
+    fitness_[victim] = fitness;
+    std::copy(key_.begin(), key_.end(), keys_.begin() + victim * dimension_);
+  }  // end of void FitnessCache::Insert()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MutationKernel(const double *x, const double *x_pbest,
+                      const double *x_r1, const double *x_r2,
+                      const double *lbound, const double *ubound,
+                      double F, long size, double *v) {              // NOLINT
+    long c = 0;                                                        // NOLINT
+#if defined(__AVX512F__)
+    const __m512d F8 = _mm512_set1_pd(F), half8 = _mm512_set1_pd(0.5);
+    for (; c + 8 <= size; c += 8) {
+      const __m512d xc = _mm512_loadu_pd(x + c);
+      __m512d vc = _mm512_add_pd(xc, _mm512_mul_pd(F8, _mm512_add_pd(
+          _mm512_sub_pd(_mm512_loadu_pd(x_pbest + c), xc),
+          _mm512_sub_pd(_mm512_loadu_pd(x_r1 + c),
+                        _mm512_loadu_pd(x_r2 + c)))));
+      const __m512d ub = _mm512_loadu_pd(ubound + c);
+      const __m512d lb = _mm512_loadu_pd(lbound + c);
+      vc = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(vc, ub, _CMP_GT_OQ), vc,
+                                _mm512_mul_pd(_mm512_add_pd(ub, xc), half8));
+      vc = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(vc, lb, _CMP_LT_OQ), vc,
+                                _mm512_mul_pd(_mm512_add_pd(lb, xc), half8));
+      _mm512_storeu_pd(v + c, vc);
+    }  // end of AVX-512 part
+#endif
+#if defined(__AVX2__)
+    const __m256d F4 = _mm256_set1_pd(F), half4 = _mm256_set1_pd(0.5);
+    for (; c + 4 <= size; c += 4) {
+      const __m256d xc = _mm256_loadu_pd(x + c);
+      __m256d vc = _mm256_add_pd(xc, _mm256_mul_pd(F4, _mm256_add_pd(
+          _mm256_sub_pd(_mm256_loadu_pd(x_pbest + c), xc),
+          _mm256_sub_pd(_mm256_loadu_pd(x_r1 + c),
+                        _mm256_loadu_pd(x_r2 + c)))));
+      const __m256d ub = _mm256_loadu_pd(ubound + c);
+      const __m256d lb = _mm256_loadu_pd(lbound + c);
+      vc = _mm256_blendv_pd(vc, _mm256_mul_pd(_mm256_add_pd(ub, xc), half4),
+                            _mm256_cmp_pd(vc, ub, _CMP_GT_OQ));
+      vc = _mm256_blendv_pd(vc, _mm256_mul_pd(_mm256_add_pd(lb, xc), half4),
+                            _mm256_cmp_pd(vc, lb, _CMP_LT_OQ));
+      _mm256_storeu_pd(v + c, vc);
+    }  // end of AVX2 part
+#endif
+    for (; c < size; ++c) {
+      // Mutation
+      v[c] = x[c] + F * ((x_pbest[c] - x[c]) + (x_r1[c] - x_r2[c]));
+      // Bounds control
+      if (v[c] > ubound[c]) v[c] = (ubound[c] + x[c])/2;
+      if (v[c] < lbound[c]) v[c] = (lbound[c] + x[c])/2;
+    }  // end of scalar part
+  }  // end of void MutationKernel()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void CrossoverKernel(const double *x, const double *uniform, double CR,
+                       long j_rand, long size, double *u) {          // NOLINT
+    const double u_j_rand = u[j_rand];
+    long c = 0;                                                        // NOLINT
+#if defined(__AVX512F__)
+    const __m512d CR8 = _mm512_set1_pd(CR);
+    for (; c + 8 <= size; c += 8) {
+      const __mmask8 from_x = _mm512_cmp_pd_mask(_mm512_loadu_pd(uniform + c),
+                                                 CR8, _CMP_GE_OQ);
+      _mm512_storeu_pd(u + c, _mm512_mask_blend_pd(
+          from_x, _mm512_loadu_pd(u + c), _mm512_loadu_pd(x + c)));
+    }  // end of AVX-512 part
+#endif
+#if defined(__AVX2__)
+    const __m256d CR4 = _mm256_set1_pd(CR);
+    for (; c + 4 <= size; c += 4) {
+      const __m256d from_x = _mm256_cmp_pd(_mm256_loadu_pd(uniform + c),
+                                           CR4, _CMP_GE_OQ);
+      _mm256_storeu_pd(u + c, _mm256_blendv_pd(
+          _mm256_loadu_pd(u + c), _mm256_loadu_pd(x + c), from_x));
+    }  // end of AVX2 part
+#endif
+    for (; c < size; ++c)
+      if (!(uniform[c] < CR)) u[c] = x[c];
+    u[j_rand] = u_j_rand;
+  }  // end of void CrossoverKernel()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  template<long D>                                                     // NOLINT
+  void MutationKernelFixed(const double *x, const double *x_pbest,
+                           const double *x_r1, const double *x_r2,
+                           const double *lbound, const double *ubound,
+                           double F, long /*size*/, double *v) {       // NOLINT
+    for (long c = 0; c < D; ++c) {                                     // NOLINT
+      double vc = x[c] + F * ((x_pbest[c] - x[c]) + (x_r1[c] - x_r2[c]));
+      vc = vc > ubound[c] ? (ubound[c] + x[c])/2 : vc;
+      v[c] = vc < lbound[c] ? (lbound[c] + x[c])/2 : vc;
+    }
+  }  // end of void MutationKernelFixed()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  template<long D>                                                     // NOLINT
+  void CrossoverKernelFixed(const double *x, const double *uniform,
+                            double CR, long j_rand, long /*size*/,     // NOLINT
+                            double *u) {
+    const double u_j_rand = u[j_rand];
+    for (long c = 0; c < D; ++c) u[c] = uniform[c] < CR ? u[c] : x[c];  // NOLINT
+    u[j_rand] = u_j_rand;
+  }  // end of void CrossoverKernelFixed()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Index is dimension, zero is for the runtime sized fallback.
+  const MutationKernelPointer kMutationKernels[kFixedDimensionMax + 1] = {
+    &MutationKernel, &MutationKernelFixed<1>, &MutationKernelFixed<2>,
+    &MutationKernelFixed<3>, &MutationKernelFixed<4>,
+    &MutationKernelFixed<5>, &MutationKernelFixed<6>,
+    &MutationKernelFixed<7>, &MutationKernelFixed<8>,
+    &MutationKernelFixed<9>, &MutationKernelFixed<10>};
+  const CrossoverKernelPointer kCrossoverKernels[kFixedDimensionMax + 1] = {
+    &CrossoverKernel, &CrossoverKernelFixed<1>, &CrossoverKernelFixed<2>,
+    &CrossoverKernelFixed<3>, &CrossoverKernelFixed<4>,
+    &CrossoverKernelFixed<5>, &CrossoverKernelFixed<6>,
+    &CrossoverKernelFixed<7>, &CrossoverKernelFixed<8>,
+    &CrossoverKernelFixed<9>, &CrossoverKernelFixed<10>};
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  double Communicator::GetTime() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }  // end of double Communicator::GetTime()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SerialCommunicator::AllGather(const double *send, long size,   // NOLINT
+                                     double *receive) {
+    std::copy(send, send + size, receive);
+  }  // end of void SerialCommunicator::AllGather()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SerialCommunicator::AllGather(const long *send, long size,     // NOLINT
+                                     long *receive) {                  // NOLINT
+    std::copy(send, send + size, receive);
+  }  // end of void SerialCommunicator::AllGather()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SerialCommunicator::AllGatherVariable(const std::vector<double> &send,
+                                             std::vector<double> *receive) {
+    receive->assign(send.begin(), send.end());
+  }  // end of void SerialCommunicator::AllGatherVariable()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SerialCommunicator::AllReduceMax(const int *send, long size,   // NOLINT
+                                        int *receive) {
+    std::copy(send, send + size, receive);
+  }  // end of void SerialCommunicator::AllReduceMax()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SerialCommunicator::AllReduceMax(const double *send, long size, // NOLINT
+                                        double *receive) {
+    std::copy(send, send + size, receive);
+  }  // end of void SerialCommunicator::AllReduceMax()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SerialCommunicator::Send(const std::vector<double> & /*message*/,
+                                int /*destination*/, int /*tag*/) {
+    throw std::invalid_argument("Serial communicator has no other ranks!");
+  }  // end of void SerialCommunicator::Send()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SerialCommunicator::Receive(std::vector<double> * /*message*/,
+                                  int /*source*/, int /*tag*/,
+                                  int * /*received_tag*/) {
+    throw std::invalid_argument("Serial communicator has no other ranks!");
+  }  // end of int SerialCommunicator::Receive()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SerialCommunicator::StartExchange(const std::vector<double> &send,
+                                         int destination,
+                                         std::vector<double> *receive,
+                                         int source, int /*tag*/) {
+    if (destination != 0 || source != 0 || send.size() != receive->size())
+      throw std::invalid_argument("Wrong exchange for serial communicator!");
+    std::copy(send.begin(), send.end(), receive->begin());
+  }  // end of void SerialCommunicator::StartExchange()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  struct ThreadCommunicator::Group {
+    explicit Group(int size)
+        : size(size), buffers(size), sizes(size), mailboxes(size) {}
+    struct Message {
+      int source, tag;
+      std::vector<double> values;
+    };
+    const int size;
+    std::mutex mutex;
+    /// @brief Notified on barrier completion and on new messages.
+    std::condition_variable changed;
+    int arrived = 0;
+    long generation = 0;                                               // NOLINT
+    std::vector<const void*> buffers;
+    std::vector<long> sizes;                                           // NOLINT
+    std::vector<std::deque<Message> > mailboxes;
+  };  // end of struct ThreadCommunicator::Group
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::vector<std::shared_ptr<Communicator> > ThreadCommunicator::CreateGroup(
+      int size) {
+    if (size < 1) throw std::invalid_argument("Wrong size of thread group!");
+    auto group = std::make_shared<Group>(size);
+    std::vector<std::shared_ptr<Communicator> > ranks;
+    for (int rank = 0; rank < size; ++rank)
+      ranks.push_back(std::shared_ptr<Communicator>(
+          new ThreadCommunicator(group, rank)));
+    return ranks;
+  }  // end of ThreadCommunicator::CreateGroup()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int ThreadCommunicator::Size() const {return group_->size;}
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::WaitAll(std::unique_lock<std::mutex> *lock) {
+    Group &group = *group_;
+    const long generation = group.generation;                          // NOLINT
+    if (++group.arrived == group.size) {
+      group.arrived = 0;
+      ++group.generation;
+      group.changed.notify_all();
+      return;
+    }
+    group.changed.wait(*lock, [&]() {return group.generation != generation;});
+  }  // end of void ThreadCommunicator::WaitAll()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::Collective(const void *send, long size,    // NOLINT
+                                      const Collect &collect) {
+    Group &group = *group_;
+    std::unique_lock<std::mutex> lock(group.mutex);
+    group.buffers[rank_] = send;
+    group.sizes[rank_] = size;
+    WaitAll(&lock);
+    // Buffers are not changed until all ranks pass the second barrier.
+    lock.unlock();
+    collect(group.buffers, group.sizes);
+    lock.lock();
+    WaitAll(&lock);
+  }  // end of void ThreadCommunicator::Collective()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::Barrier() {
+    std::unique_lock<std::mutex> lock(group_->mutex);
+    WaitAll(&lock);
+  }  // end of void ThreadCommunicator::Barrier()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::AllGather(const double *send, long size,   // NOLINT
+                                     double *receive) {
+    Collective(send, size, [&](const std::vector<const void*> &buffers,
+                               const std::vector<long> &) {            // NOLINT
+        for (int r = 0; r < Size(); ++r) {
+          const double *values = static_cast<const double*>(buffers[r]);
+          std::copy(values, values + size, receive + r * size);
+        }
+      });
+  }  // end of void ThreadCommunicator::AllGather()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::AllGather(const long *send, long size,     // NOLINT
+                                     long *receive) {                  // NOLINT
+    Collective(send, size, [&](const std::vector<const void*> &buffers,
+                               const std::vector<long> &) {            // NOLINT
+        for (int r = 0; r < Size(); ++r) {
+          const long *values = static_cast<const long*>(buffers[r]);  // NOLINT
+          std::copy(values, values + size, receive + r * size);
+        }
+      });
+  }  // end of void ThreadCommunicator::AllGather()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::AllGatherVariable(const std::vector<double> &send,
+                                             std::vector<double> *receive) {
+    Collective(send.data(), send.size(),
+               [&](const std::vector<const void*> &buffers,
+                   const std::vector<long> &sizes) {                   // NOLINT
+        receive->clear();
+        for (int r = 0; r < Size(); ++r) {
+          const double *values = static_cast<const double*>(buffers[r]);
+          receive->insert(receive->end(), values, values + sizes[r]);
+        }
+      });
+  }  // end of void ThreadCommunicator::AllGatherVariable()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::Broadcast(double *values, long size,       // NOLINT
+                                     int root) {
+    Collective(values, size, [&](const std::vector<const void*> &buffers,
+                                 const std::vector<long> &) {          // NOLINT
+        if (rank_ == root) return;
+        const double *root_values = static_cast<const double*>(buffers[root]);
+        std::copy(root_values, root_values + size, values);
+      });
+  }  // end of void ThreadCommunicator::Broadcast()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::Broadcast(long *values, long size,         // NOLINT
+                                     int root) {
+    Collective(values, size, [&](const std::vector<const void*> &buffers,
+                                 const std::vector<long> &) {          // NOLINT
+        if (rank_ == root) return;
+        const long *root_values = static_cast<const long*>(buffers[root]); // NOLINT
+        std::copy(root_values, root_values + size, values);
+      });
+  }  // end of void ThreadCommunicator::Broadcast()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::AllReduceMax(const int *send, long size,   // NOLINT
+                                        int *receive) {
+    Collective(send, size, [&](const std::vector<const void*> &buffers,
+                               const std::vector<long> &) {            // NOLINT
+        std::copy(send, send + size, receive);
+        for (int r = 0; r < Size(); ++r) {
+          const int *values = static_cast<const int*>(buffers[r]);
+          for (long n = 0; n < size; ++n)                              // NOLINT
+            receive[n] = std::max(receive[n], values[n]);
+        }
+      });
+  }  // end of void ThreadCommunicator::AllReduceMax()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::AllReduceMax(const double *send, long size, // NOLINT
+                                        double *receive) {
+    Collective(send, size, [&](const std::vector<const void*> &buffers,
+                               const std::vector<long> &) {            // NOLINT
+        std::copy(send, send + size, receive);
+        for (int r = 0; r < Size(); ++r) {
+          const double *values = static_cast<const double*>(buffers[r]);
+          for (long n = 0; n < size; ++n)                              // NOLINT
+            receive[n] = std::max(receive[n], values[n]);
+        }
+      });
+  }  // end of void ThreadCommunicator::AllReduceMax()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::Send(const std::vector<double> &message,
+                                int destination, int tag) {
+    Group &group = *group_;
+    if (destination < 0 || destination >= group.size)
+      throw std::invalid_argument("Wrong destination rank!");
+    std::lock_guard<std::mutex> lock(group.mutex);
+    group.mailboxes[destination].push_back({rank_, tag, message});
+    group.changed.notify_all();
+  }  // end of void ThreadCommunicator::Send()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int ThreadCommunicator::Receive(std::vector<double> *message, int source,
+                                  int tag, int *received_tag) {
+    Group &group = *group_;
+    std::unique_lock<std::mutex> lock(group.mutex);
+    std::deque<Group::Message> &mailbox = group.mailboxes[rank_];
+    std::deque<Group::Message>::iterator found;
+    // Messages from the same source are received in order of sending.
+    group.changed.wait(lock, [&]() {
+        found = std::find_if(mailbox.begin(), mailbox.end(),
+                             [&](const Group::Message &candidate) {
+            return (source == kAnySource || candidate.source == source)
+                && (tag == kAnyTag || candidate.tag == tag);
+          });
+        return found != mailbox.end();
+      });
+    message->swap(found->values);
+    const int message_source = found->source;
+    if (received_tag != nullptr) *received_tag = found->tag;
+    mailbox.erase(found);
+    return message_source;
+  }  // end of int ThreadCommunicator::Receive()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::StartExchange(const std::vector<double> &send,
+                                         int destination,
+                                         std::vector<double> *receive,
+                                         int source, int tag) {
+    Send(send, destination, tag);
+    exchange_receive_ = receive;
+    exchange_source_ = source;
+    exchange_tag_ = tag;
+  }  // end of void ThreadCommunicator::StartExchange()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void ThreadCommunicator::FinishExchange() {
+    if (exchange_receive_ == nullptr) return;
+    std::vector<double> message;
+    Receive(&message, exchange_source_, exchange_tag_, nullptr);
+    if (message.size() != exchange_receive_->size())
+      throw std::invalid_argument("Exchanged messages differ in size!");
+    exchange_receive_->swap(message);
+    exchange_receive_ = nullptr;
+  }  // end of void ThreadCommunicator::FinishExchange()
+#ifdef JADE_WITH_MPI
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  MpiCommunicator::MpiCommunicator(MPI_Comm comm) : comm_(comm) {
+    MPI_Comm_rank(comm_, &rank_);
+    MPI_Comm_size(comm_, &size_);
+    if (rank_ < 0) throw std::invalid_argument("MPI problem: rank < 0!");
+    if (size_ < 1) throw std::invalid_argument("MPI problem: size < 1!");
+  }  // end of MpiCommunicator::MpiCommunicator()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::AllGather(const double *send, long size,      // NOLINT
+                                  double *receive) {
+    MPI_Allgather(send, size, MPI_DOUBLE, receive, size, MPI_DOUBLE, comm_);
+  }  // end of void MpiCommunicator::AllGather()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::AllGather(const long *send, long size,        // NOLINT
+                                  long *receive) {                     // NOLINT
+    MPI_Allgather(send, size, MPI_LONG, receive, size, MPI_LONG, comm_);
+  }  // end of void MpiCommunicator::AllGather()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::AllGatherVariable(const std::vector<double> &send,
+                                          std::vector<double> *receive) {
+    int size_single = static_cast<int>(send.size());
+    std::vector<int> sizes(size_), displacements(size_, 0);
+    MPI_Allgather(&size_single, 1, MPI_INT, sizes.data(), 1, MPI_INT, comm_);
+    for (int i = 1; i < size_; ++i)
+      displacements[i] = displacements[i - 1] + sizes[i - 1];
+    receive->resize(displacements.back() + sizes.back());
+    MPI_Allgatherv(send.data(), size_single, MPI_DOUBLE, receive->data(),
+                   sizes.data(), displacements.data(), MPI_DOUBLE, comm_);
+  }  // end of void MpiCommunicator::AllGatherVariable()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::Broadcast(double *values, long size, int root) { // NOLINT
+    MPI_Bcast(values, size, MPI_DOUBLE, root, comm_);
+  }  // end of void MpiCommunicator::Broadcast()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::Broadcast(long *values, long size, int root) { // NOLINT
+    MPI_Bcast(values, size, MPI_LONG, root, comm_);
+  }  // end of void MpiCommunicator::Broadcast()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::AllReduceMax(const int *send, long size,      // NOLINT
+                                     int *receive) {
+    MPI_Allreduce(send, receive, size, MPI_INT, MPI_MAX, comm_);
+  }  // end of void MpiCommunicator::AllReduceMax()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::AllReduceMax(const double *send, long size,   // NOLINT
+                                     double *receive) {
+    MPI_Allreduce(send, receive, size, MPI_DOUBLE, MPI_MAX, comm_);
+  }  // end of void MpiCommunicator::AllReduceMax()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::Barrier() {MPI_Barrier(comm_);}
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::Send(const std::vector<double> &message,
+                             int destination, int tag) {
+    MPI_Send(message.data(), message.size(), MPI_DOUBLE, destination, tag,
+             comm_);
+  }  // end of void MpiCommunicator::Send()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int MpiCommunicator::Receive(std::vector<double> *message, int source,
+                               int tag, int *received_tag) {
+    MPI_Status status;
+    MPI_Probe(source == kAnySource ? MPI_ANY_SOURCE : source,
+              tag == kAnyTag ? MPI_ANY_TAG : tag, comm_, &status);
+    int size;
+    MPI_Get_count(&status, MPI_DOUBLE, &size);
+    message->resize(size);
+    MPI_Recv(message->data(), size, MPI_DOUBLE, status.MPI_SOURCE,
+             status.MPI_TAG, comm_, MPI_STATUS_IGNORE);
+    if (received_tag != nullptr) *received_tag = status.MPI_TAG;
+    return status.MPI_SOURCE;
+  }  // end of int MpiCommunicator::Receive()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::StartExchange(const std::vector<double> &send,
+                                      int destination,
+                                      std::vector<double> *receive,
+                                      int source, int tag) {
+    MPI_Irecv(receive->data(), receive->size(), MPI_DOUBLE, source, tag,
+              comm_, &requests_[0]);
+    MPI_Isend(send.data(), send.size(), MPI_DOUBLE, destination, tag, comm_,
+              &requests_[1]);
+  }  // end of void MpiCommunicator::StartExchange()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void MpiCommunicator::FinishExchange() {
+    MPI_Waitall(2, requests_, MPI_STATUSES_IGNORE);
+  }  // end of void MpiCommunicator::FinishExchange()
+#endif  // JADE_WITH_MPI
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::shared_ptr<Communicator> CreateDefaultCommunicator() {
+#ifdef JADE_WITH_MPI
+    int isInitialized = 0, isFinalized = 0;
+    MPI_Initialized(&isInitialized);
+    MPI_Finalized(&isFinalized);
+    if (isInitialized && !isFinalized)
+      return std::make_shared<MpiCommunicator>();
+#endif
+    return std::make_shared<SerialCommunicator>();
+  }  // end of std::shared_ptr<Communicator> CreateDefaultCommunicator()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool IsMpiLaunch() {
+    // Open MPI, MPICH (Hydra and Slurm PMI) and PMIx launchers.
+    for (const char *name : {"OMPI_COMM_WORLD_SIZE", "PMI_SIZE", "PMIX_RANK"})
+      if (std::getenv(name) != nullptr) return true;
+    return false;
+  }  // end of bool IsMpiLaunch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::Selection(long i)  {                              // NOLINT
+    const std::vector<double> &crossover_u = trial_vectors_u_[i - index_first_];
+    double f_current = evaluated_fitness_for_current_vectors_[i];
+    double f_best =
+      evaluated_fitness_for_current_vectors_[sorted_individuals_.front()];
+    double f_crossover_u =
+      evaluated_fitness_for_trial_vectors_[i - index_first_];
     bool is_success = f_crossover_u > f_current
         || f_crossover_u == f_best;  //Selected for maxima search
     if (is_find_minimum_) is_success = !is_success;
+    if (is_trial_screened_[i - index_first_]) is_success = false;
+    is_selection_success_[i] = is_success ? 1 : 0;
     if (!is_success) {
       // Case of current x and f were new for current generation.
-      x_vectors_next_generation_[i] = x_vectors_current_[i];
-      for (auto &f : evaluated_fitness_for_next_generation_) {
-        if (f.second == i) f.first = f_current;
-      }  // end of saving old fitness value in new generation.
+      std::copy(x_vectors_current_[i], x_vectors_current_[i] + dimension_,
+                x_vectors_next_generation_[i]);
+      evaluated_fitness_for_next_generation_[i] = f_current;
     } else {  // if is_success == true
-      x_vectors_next_generation_[i] = crossover_u;
-      for (auto &f : evaluated_fitness_for_next_generation_) 
-        if (f.second == i) f.first = f_crossover_u;
-      to_be_archived_best_A_.push_back(x_vectors_current_[i]);
+      std::copy(crossover_u.begin(), crossover_u.end(),
+                x_vectors_next_generation_[i]);
+      evaluated_fitness_for_next_generation_[i] = f_crossover_u;
       successful_mutation_parameters_S_F_.push_back(mutation_F_[i]);
       successful_crossover_parameters_S_CR_.push_back(crossover_CR_[i]);
       // if (process_rank_ == kOutput)
@@ -76,31 +947,94 @@ namespace jade {
       //PrintSingleVector(crossover_u);
     }  // end of dealing with success crossover
     return kDone;
-  } // end of int SubPopulation::Selection(std::vector<double> crossover_u);
+  } // end of int SubPopulation::Selection(long i);
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::ArchiveCleanUp() {
-    auto archived_last=archived_best_A_.end();
-    archived_best_A_.splice(archived_last, to_be_archived_best_A_);
-    auto size_A = archived_best_A_.size();
-    long initial_diff = size_A - subpopulation_;
-    // if (process_rank_ == kOutput)
-    //   printf("diff = %li size_A=%li subpop=%li \n ", initial_diff, size_A, subpopulation_);
-    // if (initial_diff < 1) return kDone;
+    PhaseTimer timer(&phase_time_[kArchive]);
+    // Parents replaced by successful trial vectors are archived.
+    for (long i = 0; i < subpopulation_; ++i) {                        // NOLINT
+      if (!is_selection_success_[i]) continue;
+      std::copy(x_vectors_current_[i], x_vectors_current_[i] + dimension_,
+                GetArchived(archive_size_));
+      ++archive_size_;
+    }
+    return TrimArchive();
+  } // end of int SubPopulation:: ArchiveCleanUp();
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::TrimArchive() {
+    long initial_diff = archive_size_ - subpopulation_;                // NOLINT
     // if (process_rank_ == kOutput)
-    //   printf("diff = %li size_A=%li \n ", initial_diff, size_A);
+    //   printf("diff = %li size_A=%li subpop=%li \n ", initial_diff, archive_size_, subpopulation_);
+    // Random element is removed by moving the last one in its place.
     for (long i = 0; i < initial_diff; ++i) {
-      long index_to_remove = randint(0, size_A - 1);
-      auto element_A = archived_best_A_.begin();
-      std::advance(element_A, index_to_remove);
-      archived_best_A_.erase(element_A);
-      --size_A;
+      long index_to_remove = randint(0, archive_size_ - 1);
+      --archive_size_;
+      if (index_to_remove != archive_size_)
+        std::copy(GetArchived(archive_size_),
+                  GetArchived(archive_size_) + dimension_,
+                  GetArchived(index_to_remove));
     }
-    const long new_size_A = archived_best_A_.size();
-    if (new_size_A > subpopulation_) error_status_ = kError;
+    if (archive_size_ > subpopulation_) error_status_ = kError;
     return kDone;
-  } // end of int SubPopulation:: ArchiveCleanUp();
+  } // end of int SubPopulation::TrimArchive();
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ReducePopulation() {
+    if (population_minimum_ == 0) return kDone;
+    long size = std::lround(total_population_                          // NOLINT
+        + static_cast<double>(population_minimum_ - total_population_)
+        * current_generation_ / total_generations_max_);
+    size = std::max(size, population_minimum_);
+    if (distribution_level_ == 2) size = std::max(size, migration_size_);
+    if (size >= subpopulation_) return kDone;
+    // Survivors keep their order, so all processes sharing population
+    // get the same result.
+    std::vector<long> sorted = GetSortedIndividuals();                 // NOLINT
+    std::vector<char> isRemoved(subpopulation_, 0);
+    for (long n = size; n < subpopulation_; ++n) isRemoved[sorted[n]] = 1; // NOLINT
+    std::vector<double> &fitness = evaluated_fitness_for_current_vectors_;
+    const long M = objectives_number_;                                 // NOLINT
+    long survivor = 0;                                                 // NOLINT
+    for (long i = 0; i < subpopulation_; ++i) {                        // NOLINT
+      if (isRemoved[i]) continue;
+      if (survivor != i) {
+        std::copy(x_vectors_current_[i], x_vectors_current_[i] + dimension_,
+                  x_vectors_current_[survivor]);
+        fitness[survivor] = fitness[i];
+        if (!isFedElite_.empty()) isFedElite_[survivor] = isFedElite_[i];
+        std::copy(objectives_current_.begin() + i * M,
+                  objectives_current_.begin() + (i + 1) * M,
+                  objectives_current_.begin() + survivor * M);
+      }
+      ++survivor;
+    }
+    SetPopulationSize(size);
+    TrimArchive();
+    SetSliceIndexes();
+    // Crowding of survivors differs from the one in full population.
+    if (M > 0) SetParetoScore(objectives_current_, &fitness);
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::ReducePopulation()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetPopulationSize(long size) {                   // NOLINT
+    subpopulation_ = size;
+    evaluated_fitness_for_current_vectors_.resize(subpopulation_);
+    evaluated_fitness_for_next_generation_.resize(subpopulation_);
+    sorted_individuals_.resize(subpopulation_);
+    for (long i = 0; i < subpopulation_; ++i) sorted_individuals_[i] = i;
+    objectives_current_.resize(subpopulation_ * objectives_number_);
+    objectives_next_generation_.resize(subpopulation_ * objectives_number_);
+    pareto_trial_objectives_.resize(subpopulation_ * objectives_number_);
+    return kDone;
+  }  // end of int SubPopulation::SetPopulationSize()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
@@ -157,19 +1091,93 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::RunOptimization() {
+    restart_ = 0;
+    if (restarts_max_ == 0) return RunSingleOptimization();
+    if (error_status_) return error_status_;
+    if (objectives_number_ > 0 || distribution_level_ == 3)
+      throw std::invalid_argument("Restarts are used with single objective "
+                                  "at distribution levels 0, 1 and 2 only!");
+    const long generations = total_generations_max_;                   // NOLINT
+    long generations_done = 0;                                         // NOLINT
+    elites_.clear();
+    int status = kDone;
+    while (true) {
+      total_generations_max_ = generations - generations_done;
+      status = RunSingleOptimization();
+      if (status != kDone) break;
+      generations_done += current_generation_;
+      UpdateElites();
+      if (restart_ == restarts_max_ || !isConverged_
+          || generations_done >= generations) break;
+      ++restart_;
+      const long size = std::max(total_population_, std::lround(      // NOLINT
+          total_population_ * restart_population_factor_));
+      ResizePopulation(size);
+      std::vector<std::vector<double> > feed;
+      for (const auto &elite : elites_) {
+        if (static_cast<long>(feed.size()) == size - 1) break;        // NOLINT
+        feed.push_back(elite.second);
+      }
+      SetFeed(feed);
+      // Feed is placed at the end of initial population.
+      isFedElite_.assign(size, 0);
+      std::fill(isFedElite_.end() - feed.size(), isFedElite_.end(), 1);
+      if (process_rank_ == kOutput && isOutput_)
+        printf("Restart %li at generation %li with population %li\n",
+               restart_, generations_done, size);
+    }
+    total_generations_max_ = generations;
+    current_generation_ = generations_done;
+    isFedElite_.clear();
+    return status;
+  }  // end of int SubPopulation::RunOptimization()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::RunSingleOptimization() {
     //if (process_rank_ == kOutput) printf("Start optimization..\n");
     if (error_status_) return error_status_;
-    adaptor_mutation_mu_F_ = 0.5;
-    adaptor_crossover_mu_CR_ = 0.5;
-    archived_best_A_.clear();
-    CreateInitialPopulation();
+    if (objectives_number_ > 0 && distribution_level_ > 1)
+      throw std::invalid_argument(
+          "Pareto front is searched at distribution levels 0 and 1 only!");
+    // Population could be reduced by previous run.
+    if (!isRestored_) SetPopulationSize(total_population_);
+    SetSliceIndexes();
+    if (objectives_number_ > 0)
+      pareto_trials_.Resize(total_population_, dimension_);
+    // Restarts share the budget of the first run.
+    if (restart_ == 0) {
+      start_time_ = Communicator::GetTime();
+      evaluations_ = 0;
+    }
+    best_fitness_history_size_ = 0;
+    StartTelemetry();
+    if (distribution_level_ == 3) return RunAsynchronous();
+    if (isRestored_) {
+      // Population, archive and adaptors are loaded from checkpoint.
+      isRestored_ = false;
+      // Objectives are not saved in checkpoint.
+      if (objectives_number_ > 0) EvaluateCurrentVectors();
+      else SortEvaluatedCurrent();
+    } else {
+      adaptor_mutation_mu_F_ = 0.5;
+      adaptor_crossover_mu_CR_ = 0.5;
+      // Archive of size NP is extended with at most NP parents before
+      // clean up.
+      archived_best_A_.Resize(2 * total_population_, dimension_);
+      archive_size_ = 0;
+      current_generation_ = 0;
+      if (distribution_level_ == 2)
+        migration_generator_.seed(BroadcastLong(randint(0, 1L << 62)));
+      CreateInitialPopulation();
+      EvaluateCurrentVectors();
+    }
     x_vectors_next_generation_ = x_vectors_current_;
-    EvaluateCurrentVectors();
     evaluated_fitness_for_next_generation_ =
       evaluated_fitness_for_current_vectors_;
-    for (long g = 0; g < total_generations_max_; ++g) {
-      if (process_rank_ == kOutput && g%100 == 0) printf("%li\n",g);      
-      to_be_archived_best_A_.clear();
+    for (long g = current_generation_; g < total_generations_max_; ++g) {
+      if (process_rank_ == kOutput && isOutput_ && g%100 == 0) printf("%li\n",g);      
+      StartGenerationTelemetry();
       successful_mutation_parameters_S_F_.clear();
       successful_crossover_parameters_S_CR_.clear();        
       // //debug section
@@ -178,161 +1186,373 @@ namespace jade {
       // PrintPopulation();      
       // PrintEvaluated();
       //end of debug section
-      for (long i = 0; i < subpopulation_; ++i) {
-        SetCRiFi(i);
-        std::vector<double> mutated_v, crossover_u;
-        mutated_v = Mutation(i);
-        crossover_u = Crossover(mutated_v, i);
-        Selection(crossover_u, i);
+      // All trial vectors are built from current generation, so they
+      // are evaluated as a single batch.
+      SetCRiFi();
+      for (long i = index_first_; i < index_last_; ++i) {
+        double *trial_u = &trial_vectors_u_[i - index_first_].front();
+        Mutation(i, trial_u);
+        Crossover(i, trial_u);
       }  // end of for all individuals in subpopulation
+      if (objectives_number_ > 0) {
+        // All processes get all trial vectors and select the same
+        // next generation.
+        EvaluateParetoSlice(&pareto_trials_, &pareto_trial_objectives_);
+        SelectPareto();
+      } else {
+        ScreenTrials();
+        for (long i = index_first_; i < index_last_; ++i) Selection(i);
+        UpdateSurrogateError();
+        if (distribution_level_ == 1) ExchangeNextGeneration();
+      }
       ArchiveCleanUp();
       Adaption();
-      x_vectors_current_.swap(x_vectors_next_generation_);
+      x_vectors_current_.Swap(x_vectors_next_generation_);
       evaluated_fitness_for_current_vectors_
         .swap(evaluated_fitness_for_next_generation_);
+      objectives_current_.swap(objectives_next_generation_);
       SortEvaluatedCurrent();
-      if (error_status_) return error_status_;
+      current_generation_ = g + 1;
+      ReducePopulation();
+      if (distribution_level_ == 2) {
+        // Immigrants sent one generation ago, so communication is
+        // overlapped with evolution.
+        if (isMigrationPending_) FinishMigration();
+        if ((g + 1) % migration_interval_ == 0) StartMigration();
+      }
+      if (checkpoint_interval_ > 0 && restart_ == 0
+          && current_generation_ % checkpoint_interval_ == 0) {
+        // Messages in flight are not saved.
+        if (isMigrationPending_) FinishMigration();
+        WriteCheckpoint();
+      }
+      if (error_status_) {
+        StopTelemetry();
+        return error_status_;
+      }
+      bool isStop = IsStopCriterion();
+      WriteTelemetry();
+      if (isStop) {
+        if (process_rank_ == kOutput && isOutput_)
+          printf("Stopped at generation %li\n", current_generation_);
+        break;
+      }
     }  // end of stepping generations
+    StopTelemetry();
+    if (isMigrationPending_) FinishMigration();
     PrintPopulation();      
     PrintEvaluated();
     return kDone;
-  }  // end of int SubPopulation::RunOptimization()
+  }  // end of int SubPopulation::RunSingleOptimization()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::RunAsynchronous() {
+    if (isRestored_)
+      throw std::invalid_argument("Asynchronous level ignores checkpoints!");
+    current_generation_ = 0;
+    error_status_ = process_rank_ == kOutput ? RunMaster() : RunWorker();
+    StopTelemetry();
+    BroadcastPopulation();
+    PrintPopulation();
+    PrintEvaluated();
+    return error_status_;
+  }  // end of int SubPopulation::RunAsynchronous()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::RunMaster() {
+    const long record_size = dimension_ + 1;                           // NOLINT
+    const int workers = number_of_processes_ - 1;
+    adaptor_mutation_mu_F_ = 0.5;
+    adaptor_crossover_mu_CR_ = 0.5;
+    archived_best_A_.Resize(2 * total_population_, dimension_);
+    archive_size_ = 0;
+    successful_mutation_parameters_S_F_.clear();
+    successful_crossover_parameters_S_CR_.clear();
+    CreateInitialPopulation();
+    std::vector<double> message, result;
+    std::vector<char> isBusy(number_of_processes_, 0);
+    long in_flight = 0;                                                // NOLINT
+    auto Send = [&](int worker) {
+      communicator_->Send(message, worker, kTrialTag);
+      isBusy[worker] = 1;
+      in_flight += message.size() / record_size;
+    };
+    auto Recieve = [&]() {
+      PhaseTimer timer(&phase_time_[kCommunicate]);
+      const int worker = communicator_->Receive(
+          &result, Communicator::kAnySource, kResultTag, nullptr);
+      isBusy[worker] = 0;
+      const long size = result.size();                                 // NOLINT
+      in_flight -= size / 2;
+      evaluations_ += size / 2;
+    };
+    if (workers == 0) {
+      EvaluateCurrentVectors();
+    } else {
+      // Initial population is sent in the same way as trial vectors.
+      const long batch = thread_pool_ ? thread_pool_->Size() : 1;      // NOLINT
+      long next = 0;                                                   // NOLINT
+      evaluated_fitness_for_current_vectors_.assign(subpopulation_, 0.0);
+      do {
+        for (int worker = 1; worker <= workers; ++worker) {
+          if (isBusy[worker] || next == subpopulation_) continue;
+          message.clear();
+          for (long n = 0; n < batch && next < subpopulation_; ++n, ++next) { // NOLINT
+            message.push_back(next);
+            message.insert(message.end(), x_vectors_current_[next],
+                           x_vectors_current_[next] + dimension_);
+          }
+          Send(worker);
+        }
+        Recieve();
+        for (unsigned long n = 0; n < result.size(); n += 2)           // NOLINT
+          evaluated_fitness_for_current_vectors_[
+              static_cast<long>(result[n])] = result[n + 1];         // NOLINT
+      } while (in_flight > 0 || next < subpopulation_);
+      SortEvaluatedCurrent();
+    }  // end of initial population evaluation
+    is_trial_pending_.assign(subpopulation_, 0);
+    random_batch_.resize(subpopulation_ * (dimension_ + kRandomBatchHeader));
+    trials_to_send_ = total_generations_max_ * subpopulation_;
+    trials_received_ = 0;
+    next_target_ = 0;
+    StartGenerationTelemetry();
+    if (workers == 0) {
+      while (trials_to_send_ > 0) {
+        message.clear();
+        MakeTrials(&message);
+        EvaluateTrials(message, &result);
+        AcceptTrials(result);
+      }
+      return error_status_;
+    }
+    while (true) {
+      // Workers could be idle because all individuals were pending.
+      for (int worker = 1; worker <= workers; ++worker) {
+        if (isBusy[worker]) continue;
+        message.clear();
+        if (MakeTrials(&message) == 0) break;
+        Send(worker);
+      }
+      if (in_flight == 0) break;
+      Recieve();
+      AcceptTrials(result);
+    }
+    for (int worker = 1; worker <= workers; ++worker)
+      communicator_->Send(std::vector<double>(), worker, kStopTag);
+    return error_status_;
+  }  // end of int SubPopulation::RunMaster()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::Crossover(std::vector<double> mutation_v, long i) {
-    const double CR_i = crossover_CR_[i];
-    std::vector<double> crossover_u, x_current;
-    crossover_u.resize(dimension_);
-    x_current = x_vectors_current_.at(i);
-    long j_rand = randint(0, dimension_ - 1);
-    for (long c = 0; c < dimension_; ++c) {
-      if (c == j_rand || rand(0,1) < CR_i)
-        crossover_u[c] = mutation_v[c];
-      else
-        crossover_u[c] = x_current[c];
+  int SubPopulation::RunWorker() {
+    std::vector<double> message, result;
+    while (true) {
+      int tag;
+      communicator_->Receive(&message, kOutput, Communicator::kAnyTag, &tag);
+      if (tag == kStopTag) break;
+      EvaluateTrials(message, &result);
+      communicator_->Send(result, kOutput, kResultTag);
     }
-    // //debug section
-    // if (process_rank_ == kOutput)
-    //   printf("x -> v -> u with CR_i=%4.2f j_rand=%li\n", CR_i, j_rand);
-    // PrintSingleVector(mutation_v);
-    // PrintSingleVector(x_current);
-    // PrintSingleVector(crossover_u);
-    // //end of debug section
-    return crossover_u;
-  } // end of  std::vector<double> SubPopulation::Crossover();
+    return kDone;
+  }  // end of int SubPopulation::RunWorker()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  long SubPopulation::MakeTrials(std::vector<double> *message) {       // NOLINT
+    const long record_size = dimension_ + kRandomBatchHeader;          // NOLINT
+    // Each process evaluates a batch with all its threads.
+    const long batch = thread_pool_ ? thread_pool_->Size() : 1;        // NOLINT
+    long trials = 0;                                                   // NOLINT
+    for (long n = 0; n < subpopulation_ && trials < batch             // NOLINT
+             && trials_to_send_ > 0; ++n) {
+      const long i = next_target_;                                     // NOLINT
+      next_target_ = (next_target_ + 1) % subpopulation_;
+      if (is_trial_pending_[i]) continue;
+      is_trial_pending_[i] = 1;
+      random_batch_generator_.FillUniform(&random_batch_[i * record_size],
+                                          record_size);
+      SetCRiFi(i);
+      double *trial_u = &trial_vectors_u_[i].front();
+      Mutation(i, trial_u);
+      Crossover(i, trial_u);
+      message->push_back(i);
+      message->insert(message->end(), trial_u, trial_u + dimension_);
+      ++trials;
+      --trials_to_send_;
+    }
+    return trials;
+  }  // end of long SubPopulation::MakeTrials()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::EvaluateTrials(const std::vector<double> &message,
+                                    std::vector<double> *result) {
+    const long record_size = dimension_ + 1;                           // NOLINT
+    const long trials = message.size() / record_size;                  // NOLINT
+    trial_batch_x_.resize(trials);
+    for (long n = 0; n < trials; ++n)                                  // NOLINT
+      trial_batch_x_[n].assign(&message[n * record_size + 1],
+                               &message[n * record_size + 1] + dimension_);
+    EvaluateBatch(trial_batch_x_, &trial_batch_fitness_);
+    result->resize(2 * trials);
+    for (long n = 0; n < trials; ++n) {                                // NOLINT
+      (*result)[2 * n] = message[n * record_size];
+      (*result)[2 * n + 1] = trial_batch_fitness_[n];
+    }
+    return kDone;
+  }  // end of int SubPopulation::EvaluateTrials()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::AcceptTrials(const std::vector<double> &result) {
+    std::vector<double> &fitness = evaluated_fitness_for_current_vectors_;
+    for (unsigned long n = 0; n < result.size(); n += 2) {             // NOLINT
+      const long i = static_cast<long>(result[n]);                     // NOLINT
+      const double f_trial = result[n + 1];
+      is_trial_pending_[i] = 0;
+      const double f_best = fitness[sorted_individuals_.front()];
+      bool is_success = f_trial > fitness[i] || f_trial == f_best;
+      if (is_find_minimum_) is_success = !is_success;
+      if (is_success) {
+        std::copy(x_vectors_current_[i], x_vectors_current_[i] + dimension_,
+                  GetArchived(archive_size_));
+        ++archive_size_;
+        TrimArchive();
+        std::copy(trial_vectors_u_[i].begin(), trial_vectors_u_[i].end(),
+                  x_vectors_current_[i]);
+        fitness[i] = f_trial;
+        successful_mutation_parameters_S_F_.push_back(mutation_F_[i]);
+        successful_crossover_parameters_S_CR_.push_back(crossover_CR_[i]);
+        SortEvaluatedCurrent();
+      }
+      ++trials_received_;
+      if (trials_received_ % subpopulation_ != 0) continue;
+      // Generation is over.
+      Adaption();
+      successful_mutation_parameters_S_F_.clear();
+      successful_crossover_parameters_S_CR_.clear();
+      ++current_generation_;
+      if (isOutput_ && current_generation_ % 100 == 0)
+        printf("%li\n", current_generation_);
+      if (trials_to_send_ > 0 && IsStopCriterion()) {
+        if (process_rank_ == kOutput && isOutput_)
+          printf("Stopped at generation %li\n", current_generation_);
+        trials_to_send_ = 0;
+      }
+      WriteTelemetry();
+      StartGenerationTelemetry();
+    }  // end of for all results
+    return kDone;
+  }  // end of int SubPopulation::AcceptTrials()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::Mutation(long i) {
-    std::vector<double> mutation_v, x_best_current, x_random_current,
-      x_random_archive_and_current, x_current;    
-    x_current = x_vectors_current_.at(i);
-    x_best_current = GetXpBestCurrent();
-    // //debug
-    // if (process_rank_ == kOutput) printf("x_best: ");
-    // PrintSingleVector(x_best_current);
+  int SubPopulation::BroadcastPopulation() {
+    // Rows are stored in a single buffer with padding.
+    communicator_->Broadcast(x_vectors_current_[0],
+                             subpopulation_ * x_vectors_current_.Stride(),
+                             kOutput);
+    evaluated_fitness_for_current_vectors_.resize(subpopulation_);
+    communicator_->Broadcast(evaluated_fitness_for_current_vectors_.data(),
+                             subpopulation_, kOutput);
+    current_generation_ = BroadcastLong(current_generation_);
+    double adaptors[2] = {adaptor_mutation_mu_F_, adaptor_crossover_mu_CR_};
+    communicator_->Broadcast(adaptors, 2, kOutput);
+    adaptor_mutation_mu_F_ = adaptors[0];
+    adaptor_crossover_mu_CR_ = adaptors[1];
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::BroadcastPopulation()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Crossover is done in place, on input crossover_u contains
+  /// mutation vector v_i.
+  int SubPopulation::Crossover(long i, double *crossover_u) {
+    const double *random = &random_batch_[(i - index_first_)
+                                          * (dimension_ + kRandomBatchHeader)];
+    const long j_rand = std::min(dimension_ - 1,                       // NOLINT
+                                 static_cast<long>(random[3] * dimension_)); // NOLINT
+    crossover_kernel_(x_vectors_current_[i], random + kRandomBatchHeader,
+                      crossover_CR_[i], j_rand, dimension_, crossover_u);
+    return kDone;
+  } // end of int SubPopulation::Crossover();
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::Mutation(long i, double *mutation_v) {
+    const double *x_best_current = GetXpBestCurrent();
     long index_of_random_current = -1;
-    x_random_current = GetXRandomCurrent(&index_of_random_current, i);
-    // //debug
-    // if (process_rank_ == kOutput) printf("x_random: ");
-    // PrintSingleVector(x_random_current);    
-    x_random_archive_and_current = GetXRandomArchiveAndCurrent(index_of_random_current, i);
-    // //debug
-    // if (process_rank_ == kOutput) printf("x_random with archive: ");
-    // PrintSingleVector(x_random_archive_and_current);
-    mutation_v.resize(dimension_);
-    double F_i = mutation_F_[i];
-    for (long c = 0; c < dimension_; ++c) {
-      // Mutation
-      mutation_v[c] = x_current[c]
-        + F_i * (x_best_current[c] - x_current[c])
-        + F_i * (x_random_current[c]
-                 - x_random_archive_and_current[c]);
-      // Bounds control
-      if (mutation_v[c] > x_ubound_[c])
-        mutation_v[c] = (x_ubound_[c] + x_current[c])/2;
-      if (mutation_v[c] < x_lbound_[c])
-        mutation_v[c] = (x_lbound_[c] + x_current[c])/2;
-    }
-    // //debug section
-    // int isSame = 888, isSame2 = 7777, isSame3 =11111;
-    // for (long c = 0; c < dimension_; ++c) {
-    //   double norm = std::abs(mutation_v[c] - x_current[c]);
-    //   double norm2 = std::abs(x_random_current[c] - x_current[c]);
-    //   double norm3 = std::abs(x_random_current[c]
-    //                           - x_random_archive_and_current[c]);
-    //   if ( norm  > 0.0001) isSame = 0;
-    //   if ( norm2  > 0.0001) isSame2 = 0;
-    //   if ( norm3  > 0.0001) isSame3 = 0;
-    // }
-    // if (process_rank_ == kOutput) printf("mutation_v%i%i%i:  ",isSame, isSame2, isSame3);
-    // PrintSingleVector(mutation_v);
-    // if (process_rank_ == kOutput) printf("current _v%i%i%i:  ",isSame, isSame2, isSame3);
-    // PrintSingleVector(x_current);    
-    // if (process_rank_ == kOutput)
-    //   printf("  -> f = %4.2f                                    F_i=%4.2f\n",
-    //          FitnessFunction(mutation_v), F_i);
-    // //end of debug section
-    return mutation_v;
-  } // end of std::vector<double> SubPopulation::Mutation();
+    const double *x_random_current =
+      GetXRandomCurrent(&index_of_random_current, i);
+    const double *x_random_archive_and_current =
+      GetXRandomArchiveAndCurrent(index_of_random_current, i);
+    mutation_kernel_(x_vectors_current_[i], x_best_current, x_random_current,
+                     x_random_archive_and_current, &x_lbound_.front(),
+                     &x_ubound_.front(), mutation_F_[i], dimension_,
+                     mutation_v);
+    return kDone;
+  } // end of int SubPopulation::Mutation();
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::GetXpBestCurrent() {
+  const double* SubPopulation::GetXpBestCurrent() {
     const long n_best_total = static_cast<long>
       (floor(subpopulation_ * best_share_p_ ));
     if (n_best_total == subpopulation_) error_status_ = kError;
     long best_n = randint(0, n_best_total);
-    long best_n_index = -1, i = 0;
-    for (auto x : evaluated_fitness_for_current_vectors_) {
-      if (i == best_n) {
-        best_n_index = x.second;
-        break;
-      }
-      ++i;
-    }
-    return x_vectors_current_.at(best_n_index);
-  }  // end of std::vector<double> SubPopulation::GetXpBestCurrent();
+    return x_vectors_current_[sorted_individuals_[best_n]];
+  }  // end of const double* SubPopulation::GetXpBestCurrent();
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::GetXRandomCurrent(long *index, long forbidden_index) {
+  const double* SubPopulation::GetXRandomCurrent(long *index, long forbidden_index) {
     long random_n = randint(0, subpopulation_-1);
     while (random_n == forbidden_index) random_n = randint(0, subpopulation_-1);
     (*index) = random_n;
-    return x_vectors_current_.at(random_n);
-  }  // end of std::vector<double> SubPopulation::GetXRandomCurrent()
+    return x_vectors_current_[random_n];
+  }  // end of const double* SubPopulation::GetXRandomCurrent()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  std::vector<double> SubPopulation::GetXRandomArchiveAndCurrent(long forbidden_index1, long forbidden_index2) {
-    long archive_size = archived_best_A_.size();
-    long random_n = randint(0, subpopulation_ + archive_size - 1);
+  const double* SubPopulation::GetXRandomArchiveAndCurrent(long forbidden_index1, long forbidden_index2) {
+    long random_n = randint(0, subpopulation_ + archive_size_ - 1);
     while (random_n == forbidden_index1 || random_n == forbidden_index2)
-      random_n = randint(0, subpopulation_ + archive_size - 1);
-    if (random_n < subpopulation_) return x_vectors_current_.at(random_n);
+      random_n = randint(0, subpopulation_ + archive_size_ - 1);
+    if (random_n < subpopulation_) return x_vectors_current_[random_n];
     random_n -= subpopulation_;
-    long i = 0;
-    for (auto x : archived_best_A_) {
-      if (i == random_n) {
-        // //debug
-        // if (process_rank_ == kOutput) printf("Using Archive!!\n");
-        return x;
-      }
-      ++i;
-    }  // end of selecting from archive
-    error_status_ = kError;
-    std::vector<double> x;
-    return x;    
-  }  // end of std::vector<double> SubPopulation::GetXRandomArchiveAndCurrent()
+    // //debug
+    // if (process_rank_ == kOutput) printf("Using Archive!!\n");
+    return GetArchived(random_n);
+  }  // end of const double* SubPopulation::GetXRandomArchiveAndCurrent()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  int SubPopulation::SetCRiFi(long i) {
+  int SubPopulation::SetCRiFi() {
+    const long record_size = dimension_ + kRandomBatchHeader;          // NOLINT
+    const long slice = index_last_ - index_first_;                     // NOLINT
+    random_batch_.resize(slice * record_size);
+    if (slice > 0)
+      random_batch_generator_.FillUniform(&random_batch_.front(),
+                                          random_batch_.size());
+    for (long i = index_first_; i < index_last_; ++i) SetCRiFi(i);
+    return kDone;
+  }  // end of int SubPopulation::SetCRiFi()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetCRiFi(long i) {                                // NOLINT
+    const long record_size = dimension_ + kRandomBatchHeader;          // NOLINT
+    const double *random = &random_batch_[(i - index_first_) * record_size];
+    // F_i from Cauchy distribution, regenerated if not positive.
+    double uniform = random[0];
     long k = 0;
     while (1) {
-      mutation_F_[i] = randc(adaptor_mutation_mu_F_, 0.1);
+      mutation_F_[i] = adaptor_mutation_mu_F_
+        + 0.1 * std::tan(kPi * (uniform - 0.5));
       if (mutation_F_[i] > 1) {
         mutation_F_[i] = 1;
         break;
@@ -343,9 +1563,12 @@ namespace jade {
         mutation_F_[i] = 0.001;
         break;
       }
-      if (k > 100) printf("k");
+      uniform = random_batch_generator_.Uniform();
     }
-    crossover_CR_[i] = randn(adaptor_crossover_mu_CR_,0.1);
+    // CR_i from normal distribution with Box-Muller transform.
+    crossover_CR_[i] = adaptor_crossover_mu_CR_
+      + 0.1 * std::sqrt(-2.0 * std::log(1.0 - random[1]))
+      * std::cos(2.0 * kPi * random[2]);
     if (crossover_CR_[i] > 1) crossover_CR_[i] = 1;
     if (crossover_CR_[i] < 0) crossover_CR_[i] = 0;    
     return kDone;
@@ -361,14 +1584,20 @@ namespace jade {
     dimension_ = dimension;
     if (dimension_ < 1) 
       throw std::invalid_argument("You should set dimension > 0!");
-    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank_);
-    MPI_Comm_size(MPI_COMM_WORLD, &number_of_processes_);
+    const bool isFixed = dimension_ <= kFixedDimensionMax;
+    mutation_kernel_ = kMutationKernels[isFixed ? dimension_ : 0];
+    crossover_kernel_ = kCrossoverKernels[isFixed ? dimension_ : 0];
+    if (!communicator_) communicator_ = CreateDefaultCommunicator();
+    process_rank_ = communicator_->Rank();
+    number_of_processes_ = communicator_->Size();
     if (process_rank_ < 0)
       throw std::invalid_argument("MPI problem: process_rank_ < 0!");
     if (number_of_processes_ < 1)
       throw std::invalid_argument("MPI problem: number_of_processes_ < 1!");
     std::random_device rd;
     generator_.seed(rd());
+    random_batch_generator_.Seed(
+        (static_cast<std::uint64_t>(rd()) << 32) | rd(), process_rank_);
 
     // //debug
     // CheckRandom();
@@ -376,13 +1605,14 @@ namespace jade {
     subpopulation_ = total_population;
 
     current_generation_ = 0;
-    x_vectors_current_.resize(subpopulation_);
-    for (auto &x : x_vectors_current_) x.resize(dimension_);
-    x_vectors_next_generation_.resize(subpopulation_);
-    for (auto &x : x_vectors_next_generation_) x.resize(dimension_);
+    x_vectors_current_.Resize(subpopulation_, dimension_);
+    x_vectors_next_generation_.Resize(subpopulation_, dimension_);
     evaluated_fitness_for_current_vectors_.resize(subpopulation_);
+    evaluated_fitness_for_next_generation_.resize(subpopulation_);
+    sorted_individuals_.resize(subpopulation_);
+    for (long i = 0; i < subpopulation_; ++i) sorted_individuals_[i] = i;
     // //debug
-    // if (process_rank_ == kOutput) printf("%i, x1 size = %li \n", process_rank_, x_vectors_current_.size());
+    // if (process_rank_ == kOutput) printf("%i, x1 size = %li \n", process_rank_, x_vectors_current_.Rows());
     x_lbound_.resize(dimension_);
     x_ubound_.resize(dimension_);
     mutation_F_.resize(subpopulation_);
@@ -393,11 +1623,10 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::PrintPopulation() {
-    if (process_rank_ == kOutput) {
+    if (process_rank_ == kOutput && isOutput_) {
       printf("\n");	
-      for (auto x : evaluated_fitness_for_current_vectors_) {
-	long n = x.second;
-	double fitness = x.first;
+      for (auto n : GetSortedIndividuals()) {
+	double fitness = evaluated_fitness_for_current_vectors_[n];
         printf("%6.2f:% 3li||", fitness, n);
         for (long c = 0; c < dimension_; ++c) 
           printf(" %+7.2f ", x_vectors_current_[n][c]);
@@ -418,9 +1647,9 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::PrintEvaluated() {
-    if (process_rank_ == kOutput) {
-      for (auto x : evaluated_fitness_for_current_vectors_)
-        printf("%li:%4.2f  ", x.second, x.first);
+    if (process_rank_ == kOutput && isOutput_) {
+      for (auto n : GetSortedIndividuals())
+        printf("%li:%4.2f  ", n, evaluated_fitness_for_current_vectors_[n]);
       printf("\n");
     }  // end of if output
     return kDone;
@@ -428,13 +1657,13 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  int SubPopulation::PrintSingleVector(std::vector<double> x) {
+  int SubPopulation::PrintSingleVector(const std::vector<double> &x) {
     if (process_rank_ == kOutput) {
       for (auto c : x) printf("%5.2f ", c);
       printf("\n");
     }  // end of output
     return kDone;
-  }  // end of int SubPopulation::PrintSingleVector(std::vector<double> x)
+  }  // end of int SubPopulation::PrintSingleVector()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
@@ -456,24 +1685,25 @@ namespace jade {
   int SubPopulation::CreateInitialPopulation() {
     if ((subpopulation_ - x_feed_vectors_.size()) <1)
       throw std::invalid_argument("Too large feed!");
-    x_vectors_current_.resize(subpopulation_ - x_feed_vectors_.size());
-    for (auto &x : x_vectors_current_)
+    long n = subpopulation_ - x_feed_vectors_.size();                  // NOLINT
+    for (long k = 0; k < n; ++k)                                       // NOLINT
       for (long i = 0; i < dimension_; ++i) {
         if (x_lbound_[i] > x_ubound_[i])
 	  throw std::invalid_argument("Wrong order of bounds!");
-        x[i] = rand(x_lbound_[i], x_ubound_[i]);                            // NOLINT
+        x_vectors_current_[k][i] = rand(x_lbound_[i], x_ubound_[i]);          // NOLINT
       }  // end of for each dimension
     // //debug
-    // for (auto x : x_vectors_current_[0]) if (process_rank_ == kOutput) printf("%g ",x);
+    // for (long i = 0; i < dimension_; ++i) if (process_rank_ == kOutput) printf("%g ",x_vectors_current_[0][i]);
     for (auto x: x_feed_vectors_) {
-      x_vectors_current_.push_back(x);
-        if (process_rank_ == kOutput) {
+      std::copy(x.begin(), x.end(), x_vectors_current_[n]);
+      ++n;
+        if (process_rank_ == kOutput && isOutput_) {
 	  printf("--=-- Feed:\n");
 	  for (auto index:x) printf(" %+7.2f", index);
 	  printf("\n");
 	}	
     }
-    if (x_vectors_current_.size() != subpopulation_)
+    if (n != subpopulation_)
       throw std::invalid_argument("Population is not full after feed!");	
     x_feed_vectors_.clear();
     // if (process_rank_ == kOutput) {
@@ -487,24 +1717,57 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::SortEvaluatedCurrent() {
-    evaluated_fitness_for_current_vectors_
-      .sort([=](const std::pair<double, long>& a,                     // NOLINT
-               const std::pair<double, long>& b) {                   // NOLINT
-              bool cmp = a.first < b.first;
-              if (is_find_minimum_) return cmp;
-              return !cmp;
-            });
+    // p-best selection needs n_best_total + 1 best individuals.
+    long n_sorted = static_cast<long>                                  // NOLINT
+      (floor(subpopulation_ * best_share_p_)) + 1;
+    if (distribution_level_ == 2)
+      n_sorted = std::max(n_sorted, migration_size_);
+    sorted_individuals_size_ = std::min(n_sorted, subpopulation_);
+    const std::vector<double> &fitness = evaluated_fitness_for_current_vectors_;
+    // Ties are resolved by index to have the same order on all processes.
+    std::partial_sort(sorted_individuals_.begin(),
+                      sorted_individuals_.begin() + sorted_individuals_size_,
+                      sorted_individuals_.end(),
+                      [&](long a, long b) {                            // NOLINT
+                        if (fitness[a] == fitness[b]) return a < b;
+                        return IsBetter(fitness[a], fitness[b]);
+                      });
     return kDone;
   }  // end of int SubPopulation::SortEvaluatedCurrent()
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  std::vector<long> SubPopulation::GetSortedIndividuals() {           // NOLINT
+    std::vector<long> sorted = sorted_individuals_;                   // NOLINT
+    const std::vector<double> &fitness = evaluated_fitness_for_current_vectors_;
+    std::sort(sorted.begin(), sorted.end(), [&](long a, long b) {    // NOLINT
+        if (fitness[a] == fitness[b]) return a < b;
+        return IsBetter(fitness[a], fitness[b]);
+      });
+    return sorted;
+  }  // end of std::vector<long> SubPopulation::GetSortedIndividuals()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   int SubPopulation::EvaluateCurrentVectors() {
-    evaluated_fitness_for_current_vectors_.clear();
-    for (long i = 0; i < subpopulation_; ++i) {                        // NOLINT
-      auto tmp = std::make_pair(FitnessFunction(x_vectors_current_[i]), i);
-      evaluated_fitness_for_current_vectors_.push_back(tmp);
+    for (long i = index_first_; i < index_last_; ++i)                  // NOLINT
+      trial_vectors_u_[i - index_first_].assign(
+          x_vectors_current_[i], x_vectors_current_[i] + dimension_);
+    if (objectives_number_ > 0) {
+      EvaluateParetoSlice(&x_vectors_current_, &objectives_current_);
+      SetParetoScore(objectives_current_,
+                     &evaluated_fitness_for_current_vectors_);
+      return SortEvaluatedCurrent();
     }
+    EvaluateBatch(trial_vectors_u_, &evaluated_fitness_for_trial_vectors_);
+    // Individuals out of the slice are evaluated by other processes.
+    evaluated_fitness_for_current_vectors_.assign(subpopulation_, 0.0);
+    for (long i = index_first_; i < index_last_; ++i)                  // NOLINT
+      evaluated_fitness_for_current_vectors_[i] =
+        evaluated_fitness_for_trial_vectors_[i - index_first_];
+    if (distribution_level_ == 1)
+      ExchangeSlices(&x_vectors_current_,
+                     &evaluated_fitness_for_current_vectors_);
     SortEvaluatedCurrent();
     // //debug
     // if (process_rank_ == kOutput) printf("\n After ");
@@ -515,13 +1778,793 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
-  void SubPopulation::SetAllBoundsVectors
-  (std::vector<double> lbound, std::vector<double> ubound) {
-    x_lbound_.clear();
-    x_ubound_.clear();    
-    for (auto x : lbound) x_lbound_.push_back(x);
-    for (auto x : ubound) x_ubound_.push_back(x);
-  }
+  int SubPopulation::EvaluateBatch(const std::vector<std::vector<double> > &x,
+                                   std::vector<double> *fitness) {
+    if (!fitness_cache_) return EvaluateBatchUncached(x, fitness);
+    fitness->resize(x.size());
+    long missed = 0;                                                   // NOLINT
+    cache_missed_index_.clear();
+    for (unsigned long n = 0; n < x.size(); ++n) {                     // NOLINT
+      if (fitness_cache_->Find(x[n], &(*fitness)[n])) continue;
+      // Rows of cache_missed_x_ are reused to keep their memory.
+      if (static_cast<long>(cache_missed_x_.size()) <= missed)       // NOLINT
+        cache_missed_x_.resize(missed + 1);
+      cache_missed_x_[missed++] = x[n];
+      cache_missed_index_.push_back(n);
+    }
+    cache_missed_x_.resize(missed);
+    EvaluateBatchUncached(cache_missed_x_, &cache_missed_fitness_);
+    for (long k = 0; k < missed; ++k)                                  // NOLINT
+      (*fitness)[cache_missed_index_[k]] = cache_missed_fitness_[k];
+    // Asynchronous workers do not evaluate batches simultaneously.
+    if (isCacheShared_ && number_of_processes_ > 1 && distribution_level_ != 3)
+      return ShareFitnessCache();
+    for (long k = 0; k < missed; ++k)                                  // NOLINT
+      fitness_cache_->Insert(cache_missed_x_[k].data(),
+                             cache_missed_fitness_[k]);
+    return kDone;
+  }  // end of int SubPopulation::EvaluateBatch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ScreenTrials() {
+    const long slice = index_last_ - index_first_;                     // NOLINT
+    is_trial_screened_.assign(slice, 0);
+    screened_trials_ = 0;
+    if (!isSurrogate_)
+      return EvaluateBatch(trial_vectors_u_,
+                           &evaluated_fitness_for_trial_vectors_);
+    // Distances between individuals are shared by all predictions.
+    surrogate_pair_distance_.resize(subpopulation_ * subpopulation_);
+    for (long a = 0; a < subpopulation_; ++a) {                        // NOLINT
+      surrogate_pair_distance_[a * subpopulation_ + a] = 0.0;
+      for (long b = 0; b < a; ++b) {                                   // NOLINT
+        double distance = GetScaledDistance(x_vectors_current_[a],
+                                            x_vectors_current_[b]);
+        surrogate_pair_distance_[a * subpopulation_ + b] = distance;
+        surrogate_pair_distance_[b * subpopulation_ + a] = distance;
+      }
+    }
+    surrogate_gain_.resize(slice);
+    for (long s = 0; s < slice; ++s) {                                 // NOLINT
+      double predicted = PredictFitness(&trial_vectors_u_[s].front());
+      double parent = evaluated_fitness_for_current_vectors_[index_first_ + s];
+      surrogate_gain_[s] = is_find_minimum_ ? parent - predicted
+          : predicted - parent;
+    }
+    const long evaluated = std::min(slice, static_cast<long>(          // NOLINT
+        std::ceil(surrogate_share_ * slice)));
+    surrogate_order_.resize(slice);
+    std::iota(surrogate_order_.begin(), surrogate_order_.end(), 0);
+    std::nth_element(surrogate_order_.begin(),
+                     surrogate_order_.begin() + evaluated,
+                     surrogate_order_.end(), [&](long a, long b) {     // NOLINT
+                       return surrogate_gain_[a] > surrogate_gain_[b];
+                     });
+    surrogate_x_.resize(evaluated);
+    for (long m = 0; m < evaluated; ++m)                               // NOLINT
+      surrogate_x_[m] = trial_vectors_u_[surrogate_order_[m]];
+    EvaluateBatch(surrogate_x_, &surrogate_fitness_);
+    // Skipped trials keep fitness of their parents and always lose.
+    evaluated_fitness_for_trial_vectors_.assign(
+        evaluated_fitness_for_current_vectors_.begin() + index_first_,
+        evaluated_fitness_for_current_vectors_.begin() + index_last_);
+    is_trial_screened_.assign(slice, 1);
+    for (long m = 0; m < evaluated; ++m) {                             // NOLINT
+      evaluated_fitness_for_trial_vectors_[surrogate_order_[m]] =
+        surrogate_fitness_[m];
+      is_trial_screened_[surrogate_order_[m]] = 0;
+    }
+    screened_trials_ = slice - evaluated;
+    return kDone;
+  }  // end of int SubPopulation::ScreenTrials()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  double SubPopulation::GetScaledDistance(const double *a,
+                                          const double *b) const {
+    double sum = 0.0;
+    for (long c = 0; c < dimension_; ++c)                              // NOLINT
+      sum += pow2((a[c] - b[c]) / (x_ubound_[c] - x_lbound_[c]));
+    return sum;
+  }  // end of double SubPopulation::GetScaledDistance()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Gaussian basis functions are centered at neighbours, their width
+  /// is the mean squared distance to neighbours.
+  double SubPopulation::PredictFitness(const double *x) {
+    const long k = std::min(surrogate_neighbours_, subpopulation_);   // NOLINT
+    surrogate_distance_.resize(subpopulation_);
+    surrogate_index_.resize(subpopulation_);
+    for (long i = 0; i < subpopulation_; ++i)                          // NOLINT
+      surrogate_distance_[i] = GetScaledDistance(x, x_vectors_current_[i]);
+    std::iota(surrogate_index_.begin(), surrogate_index_.end(), 0);
+    std::partial_sort(surrogate_index_.begin(), surrogate_index_.begin() + k,
+                      surrogate_index_.end(), [&](long a, long b) {    // NOLINT
+                        return surrogate_distance_[a] < surrogate_distance_[b];
+                      });
+    double mean_distance = 0.0, mean_fitness = 0.0;
+    for (long a = 0; a < k; ++a) {                                     // NOLINT
+      mean_distance += surrogate_distance_[surrogate_index_[a]];
+      mean_fitness +=
+        evaluated_fitness_for_current_vectors_[surrogate_index_[a]];
+    }
+    mean_distance /= k;
+    mean_fitness /= k;
+    if (!(mean_distance > 0.0)) return mean_fitness;
+    const double scale = 1.0 / mean_distance;
+    // Small ridge keeps Gram matrix positive definite for close
+    // neighbours.
+    const double kRidge = 1e-8;
+    surrogate_gram_.resize(k * k);
+    surrogate_weights_.resize(k);
+    for (long a = 0; a < k; ++a) {                                     // NOLINT
+      const double *distance_a =
+        &surrogate_pair_distance_[surrogate_index_[a] * subpopulation_];
+      for (long b = 0; b < a; ++b)                                     // NOLINT
+        surrogate_gram_[a * k + b] =
+          std::exp(-scale * distance_a[surrogate_index_[b]]);
+      surrogate_gram_[a * k + a] = 1.0 + kRidge;
+      surrogate_weights_[a] =
+        evaluated_fitness_for_current_vectors_[surrogate_index_[a]]
+        - mean_fitness;
+    }
+    // Cholesky decomposition in lower triangle, then forward and
+    // backward substitution.
+    double *L = &surrogate_gram_.front();
+    for (long a = 0; a < k; ++a) {                                     // NOLINT
+      for (long b = 0; b <= a; ++b) {                                  // NOLINT
+        double sum = L[a * k + b];
+        for (long c = 0; c < b; ++c) sum -= L[a * k + c] * L[b * k + c]; // NOLINT
+        if (a != b) {
+          L[a * k + b] = sum / L[b * k + b];
+        } else {
+          if (!(sum > 0.0)) return mean_fitness;
+          L[a * k + a] = std::sqrt(sum);
+        }
+      }
+    }
+    double *w = &surrogate_weights_.front();
+    for (long a = 0; a < k; ++a) {                                     // NOLINT
+      for (long c = 0; c < a; ++c) w[a] -= L[a * k + c] * w[c];        // NOLINT
+      w[a] /= L[a * k + a];
+    }
+    for (long a = k - 1; a >= 0; --a) {                                // NOLINT
+      for (long c = a + 1; c < k; ++c) w[a] -= L[c * k + a] * w[c];    // NOLINT
+      w[a] /= L[a * k + a];
+    }
+    double predicted = mean_fitness;
+    for (long a = 0; a < k; ++a)                                       // NOLINT
+      predicted += w[a] * std::exp(-scale *
+                                   surrogate_distance_[surrogate_index_[a]]);
+    return predicted;
+  }  // end of double SubPopulation::PredictFitness()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::UpdateSurrogateError() {
+    if (!isSurrogate_) return kDone;
+    const long evaluated = index_last_ - index_first_ - screened_trials_; // NOLINT
+    // Prediction error is compared with the one of using parent
+    // fitness as a prediction.
+    double error_sum = 0.0, parent_error_sum = 0.0;
+    for (long m = 0; m < evaluated; ++m) {                             // NOLINT
+      long s = surrogate_order_[m];                                    // NOLINT
+      double parent = evaluated_fitness_for_current_vectors_[index_first_ + s];
+      double fitness = evaluated_fitness_for_trial_vectors_[s];
+      double gain = is_find_minimum_ ? parent - fitness : fitness - parent;
+      error_sum += std::fabs(gain - surrogate_gain_[s]);
+      parent_error_sum += std::fabs(gain);
+    }
+    if (distribution_level_ == 1) {
+      // Each process has evaluated its own slice, error is summed over
+      // the shared population so that all processes switch surrogate
+      // off at the same generation.
+      AllGatherVectorDouble({error_sum, parent_error_sum});
+      error_sum = 0.0;
+      parent_error_sum = 0.0;
+      for (int p = 0; p < number_of_processes_; ++p) {
+        error_sum += recieve_double_[2 * p];
+        parent_error_sum += recieve_double_[2 * p + 1];
+      }
+    }
+    if (!(parent_error_sum > 0.0)) return kDone;
+    double error = error_sum / parent_error_sum;
+    // Same averaging as for adaptors.
+    const double c = adaptation_frequency_c_;
+    surrogate_error_ = surrogate_generations_ == 0 ? error
+        : (1.0 - c) * surrogate_error_ + c * error;
+    ++surrogate_generations_;
+    if (surrogate_generations_ * c >= 1.0
+        && surrogate_error_ > surrogate_max_error_) {
+      isSurrogate_ = false;
+      if (process_rank_ == kOutput && isOutput_)
+        printf("Surrogate is switched off at generation %li, error %g\n",
+               current_generation_, surrogate_error_);
+    }
+    return kDone;
+  }  // end of int SubPopulation::UpdateSurrogateError()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::EvaluateBatchUncached(
+      const std::vector<std::vector<double> > &x,
+      std::vector<double> *fitness) {
+    PhaseTimer timer(&phase_time_[kEvaluate]);
+    if (BatchFitnessFunction != nullptr) {
+      evaluations_ += x.size();
+      BatchFitnessFunction(x, *fitness);
+      if (fitness->size() != x.size())
+        throw std::invalid_argument("Batch fitness has wrong size!");
+      return kDone;
+    }
+    evaluations_ += x.size();
+    if (FitnessFunction == nullptr)
+      throw std::invalid_argument("You should set fitness function!");
+    fitness->resize(x.size());
+    if (thread_pool_) {
+      thread_pool_->Run(x.size(), [&](long n) {                        // NOLINT
+          (*fitness)[n] = FitnessFunction(x[n]);
+        });
+      return kDone;
+    }
+    for (unsigned long n = 0; n < x.size(); ++n)                       // NOLINT
+      (*fitness)[n] = FitnessFunction(x[n]);
+    return kDone;
+  }  // end of int SubPopulation::EvaluateBatchUncached()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ShareFitnessCache() {
+    PhaseTimer timer(&phase_time_[kCommunicate]);
+    const long entry_size = dimension_ + 1;                            // NOLINT
+    cache_send_.resize(cache_missed_x_.size() * entry_size);
+    for (unsigned long k = 0; k < cache_missed_x_.size(); ++k) {       // NOLINT
+      std::copy(cache_missed_x_[k].begin(), cache_missed_x_[k].end(),
+                cache_send_.begin() + k * entry_size);
+      cache_send_[k * entry_size + dimension_] = cache_missed_fitness_[k];
+    }
+    AllGatherVariableVectorDouble(cache_send_);
+    // All processes insert the same entries in the same order, so
+    // their caches stay identical.
+    for (unsigned long n = 0; n < recieve_double_.size(); n += entry_size) // NOLINT
+      fitness_cache_->Insert(&recieve_double_[n],
+                             recieve_double_[n + dimension_]);
+    return kDone;
+  }  // end of int SubPopulation::ShareFitnessCache()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetSliceIndexes() {
+    if (distribution_level_ == 1) {
+      slice_size_ = (subpopulation_ + number_of_processes_ - 1)
+        / number_of_processes_;
+      index_first_ = std::min(process_rank_ * slice_size_, subpopulation_);
+      index_last_ = std::min(index_first_ + slice_size_, subpopulation_);
+    } else {
+      slice_size_ = subpopulation_;
+      index_first_ = 0;
+      index_last_ = subpopulation_;
+    }
+    is_selection_success_.assign(subpopulation_, 0);
+    is_trial_screened_.assign(index_last_ - index_first_, 0);
+    trial_vectors_u_.resize(index_last_ - index_first_);
+    for (auto &u : trial_vectors_u_) u.resize(dimension_);
+    return kDone;
+  }  // end of int SubPopulation::SetSliceIndexes()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Each process packs its slice of state vectors together with
+  /// fitness, F_i, CR_i and selection result. Slices are padded to the
+  /// same size and ordered by rank, so after gather the record for
+  /// individual i is exactly at position i.
+  int SubPopulation::ExchangeSlices(
+      PopulationMatrix *x_vectors, std::vector<double> *evaluated_fitness) {
+    PhaseTimer timer(&phase_time_[kCommunicate]);
+    const long record_size = dimension_ + 3;                           // NOLINT
+    std::vector<double> &fitness = *evaluated_fitness;
+    std::vector<double> to_send_double(slice_size_ * record_size, 0.0);
+    std::vector<long> to_send_long(slice_size_, 0);                    // NOLINT
+    for (long i = index_first_; i < index_last_; ++i) {                // NOLINT
+      auto record = to_send_double.begin() + (i - index_first_) * record_size;
+      std::copy((*x_vectors)[i], (*x_vectors)[i] + dimension_, record);
+      record[dimension_] = fitness[i];
+      record[dimension_ + 1] = mutation_F_[i];
+      record[dimension_ + 2] = crossover_CR_[i];
+      to_send_long[i - index_first_] = is_selection_success_[i];
+    }  // end of packing current slice
+    AllGatherVectorDouble(to_send_double);
+    AllGatherVectorLong(to_send_long);
+    for (long i = 0; i < subpopulation_; ++i) {                        // NOLINT
+      auto record = recieve_double_.begin() + i * record_size;
+      std::copy(record, record + dimension_, (*x_vectors)[i]);
+      fitness[i] = record[dimension_];
+      mutation_F_[i] = record[dimension_ + 1];
+      crossover_CR_[i] = record[dimension_ + 2];
+      is_selection_success_[i] = recieve_long_[i];
+    }  // end of unpacking all slices
+    return kDone;
+  }  // end of int SubPopulation::ExchangeSlices()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ExchangeNextGeneration() {
+    ExchangeSlices(&x_vectors_next_generation_,
+                   &evaluated_fitness_for_next_generation_);
+    // Rebuild data for adaption from all slices, so it is the same for
+    // all processes.
+    successful_mutation_parameters_S_F_.clear();
+    successful_crossover_parameters_S_CR_.clear();
+    for (long i = 0; i < subpopulation_; ++i) {                        // NOLINT
+      if (!is_selection_success_[i]) continue;
+      successful_mutation_parameters_S_F_.push_back(mutation_F_[i]);
+      successful_crossover_parameters_S_CR_.push_back(crossover_CR_[i]);
+    }  // end of collecting successful individuals
+    return kDone;
+  }  // end of int SubPopulation::ExchangeNextGeneration()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::EvaluateParetoSlice(PopulationMatrix *x_vectors,
+                                         std::vector<double> *objectives) {
+    const long M = objectives_number_;                                 // NOLINT
+    EvaluateObjectives(trial_vectors_u_, &pareto_slice_objectives_);
+    for (long i = index_first_; i < index_last_; ++i) {                // NOLINT
+      const std::vector<double> &u = trial_vectors_u_[i - index_first_];
+      std::copy(u.begin(), u.end(), (*x_vectors)[i]);
+      std::copy(pareto_slice_objectives_.begin() + (i - index_first_) * M,
+                pareto_slice_objectives_.begin() + (i - index_first_ + 1) * M,
+                objectives->begin() + i * M);
+    }
+    if (distribution_level_ == 1) ExchangeObjectives(x_vectors, objectives);
+    return kDone;
+  }  // end of int SubPopulation::EvaluateParetoSlice()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::EvaluateObjectives(
+      const std::vector<std::vector<double> > &x,
+      std::vector<double> *objectives) {
+    PhaseTimer timer(&phase_time_[kEvaluate]);
+    if (ObjectivesFunction == nullptr)
+      throw std::invalid_argument("You should set objectives function!");
+    const long M = objectives_number_;                                 // NOLINT
+    evaluations_ += x.size();
+    objectives->resize(x.size() * M);
+    auto evaluate = [&](long n) {                                      // NOLINT
+      thread_local std::vector<double> values;
+      ObjectivesFunction(x[n], values);
+      if (static_cast<long>(values.size()) != M)                       // NOLINT
+        throw std::invalid_argument("Objectives have wrong size!");
+      std::copy(values.begin(), values.end(), objectives->begin() + n * M);
+    };
+    if (thread_pool_) {
+      thread_pool_->Run(x.size(), evaluate);
+      return kDone;
+    }
+    for (unsigned long n = 0; n < x.size(); ++n) evaluate(n);          // NOLINT
+    return kDone;
+  }  // end of int SubPopulation::EvaluateObjectives()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ExchangeObjectives(PopulationMatrix *x_vectors,
+                                        std::vector<double> *objectives) {
+    PhaseTimer timer(&phase_time_[kCommunicate]);
+    const long M = objectives_number_;                                 // NOLINT
+    const long record_size = dimension_ + M + 2;                       // NOLINT
+    std::vector<double> to_send(slice_size_ * record_size, 0.0);
+    for (long i = index_first_; i < index_last_; ++i) {                // NOLINT
+      auto record = to_send.begin() + (i - index_first_) * record_size;
+      std::copy((*x_vectors)[i], (*x_vectors)[i] + dimension_, record);
+      std::copy(objectives->begin() + i * M,
+                objectives->begin() + (i + 1) * M, record + dimension_);
+      record[dimension_ + M] = mutation_F_[i];
+      record[dimension_ + M + 1] = crossover_CR_[i];
+    }  // end of packing current slice
+    AllGatherVectorDouble(to_send);
+    for (long i = 0; i < subpopulation_; ++i) {                        // NOLINT
+      auto record = recieve_double_.begin() + i * record_size;
+      std::copy(record, record + dimension_, (*x_vectors)[i]);
+      std::copy(record + dimension_, record + dimension_ + M,
+                objectives->begin() + i * M);
+      mutation_F_[i] = record[dimension_ + M];
+      crossover_CR_[i] = record[dimension_ + M + 1];
+    }  // end of unpacking all slices
+    return kDone;
+  }  // end of int SubPopulation::ExchangeObjectives()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Parent i and trial vector i are individuals i and
+  /// subpopulation_ + i of the merged population. Selected parents
+  /// keep their places, places of rejected ones are taken by selected
+  /// trial vectors (own trial vector first), so rejected parents are
+  /// archived by ArchiveCleanUp().
+  int SubPopulation::SelectPareto() {
+    const long N = subpopulation_, M = objectives_number_;             // NOLINT
+    pareto_union_objectives_.resize(2 * N * M);
+    std::copy(objectives_current_.begin(), objectives_current_.begin() + N * M,
+              pareto_union_objectives_.begin());
+    std::copy(pareto_trial_objectives_.begin(),
+              pareto_trial_objectives_.begin() + N * M,
+              pareto_union_objectives_.begin() + N * M);
+    SortFronts(pareto_union_objectives_, 2 * N, &pareto_rank_,
+               &pareto_crowding_);
+    pareto_order_.resize(2 * N);
+    for (long n = 0; n < 2 * N; ++n) pareto_order_[n] = n;             // NOLINT
+    // Ties are resolved by index to have the same order on all processes.
+    std::sort(pareto_order_.begin(), pareto_order_.end(),
+              [&](long a, long b) {                                    // NOLINT
+                if (pareto_rank_[a] != pareto_rank_[b])
+                  return pareto_rank_[a] < pareto_rank_[b];
+                if (pareto_crowding_[a] != pareto_crowding_[b])
+                  return pareto_crowding_[a] > pareto_crowding_[b];
+                return a < b;
+              });
+    std::vector<char> isSelected(2 * N, 0);
+    for (long n = 0; n < N; ++n) isSelected[pareto_order_[n]] = 1;     // NOLINT
+    successful_mutation_parameters_S_F_.clear();
+    successful_crossover_parameters_S_CR_.clear();
+    // Selected trial vectors not placed yet.
+    pareto_index_.clear();
+    for (long i = 0; i < N; ++i) {                                     // NOLINT
+      is_selection_success_[i] = isSelected[i] ? 0 : 1;
+      if (!isSelected[N + i]) continue;
+      successful_mutation_parameters_S_F_.push_back(mutation_F_[i]);
+      successful_crossover_parameters_S_CR_.push_back(crossover_CR_[i]);
+      if (isSelected[i]) pareto_index_.push_back(i);
+    }
+    auto trial = pareto_index_.begin();
+    for (long i = 0; i < N; ++i) {                                     // NOLINT
+      long source = i;                                                 // NOLINT
+      const double *x = x_vectors_current_[i];
+      if (!isSelected[i]) {
+        source = isSelected[N + i] ? i : *trial++;
+        x = pareto_trials_[source];
+        source += N;
+      }
+      std::copy(x, x + dimension_, x_vectors_next_generation_[i]);
+      std::copy(pareto_union_objectives_.begin() + source * M,
+                pareto_union_objectives_.begin() + (source + 1) * M,
+                objectives_next_generation_.begin() + i * M);
+    }
+    return SetParetoScore(objectives_next_generation_,
+                          &evaluated_fitness_for_next_generation_);
+  }  // end of int SubPopulation::SelectPareto()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::GetDominance(const double *a, const double *b) const {
+    bool isBetter = false, isWorse = false;
+    for (long m = 0; m < objectives_number_; ++m) {                    // NOLINT
+      if (IsBetter(a[m], b[m])) isBetter = true;
+      else if (IsBetter(b[m], a[m])) isWorse = true;
+    }
+    if (isBetter == isWorse) return 0;
+    return isBetter ? 1 : -1;
+  }  // end of int SubPopulation::GetDominance()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Fast non-dominated sorting and crowding distance from Kalyanmoy
+  /// Deb et al. 'A fast and elitist multiobjective genetic algorithm:
+  /// NSGA-II', IEEE Trans. Evol. Comput. 6(2), 2002. Crowding is the
+  /// sum of normalized distances between neighbours along each
+  /// objective, infinite for boundary individuals of a front.
+  int SubPopulation::SortFronts(const std::vector<double> &objectives,
+                                long size, std::vector<long> *rank_ptr, // NOLINT
+                                std::vector<double> *crowding_ptr) {
+    const long M = objectives_number_;                                 // NOLINT
+    std::vector<long> &rank = *rank_ptr;                               // NOLINT
+    std::vector<double> &crowding = *crowding_ptr;
+    const double *f = objectives.data();
+    rank.assign(size, 0);
+    crowding.assign(size, 0.0);
+    pareto_dominated_count_.assign(size, 0);
+    // Lists keep their memory between generations.
+    if (static_cast<long>(pareto_dominated_.size()) < size)           // NOLINT
+      pareto_dominated_.resize(size);
+    for (long p = 0; p < size; ++p) pareto_dominated_[p].clear();      // NOLINT
+    for (long p = 0; p < size; ++p) {                                  // NOLINT
+      for (long q = p + 1; q < size; ++q) {                            // NOLINT
+        int dominance = GetDominance(f + p * M, f + q * M);
+        if (dominance > 0) {
+          pareto_dominated_[p].push_back(q);
+          ++pareto_dominated_count_[q];
+        } else if (dominance < 0) {
+          pareto_dominated_[q].push_back(p);
+          ++pareto_dominated_count_[p];
+        }
+      }
+    }
+    std::vector<long> front, next_front;                               // NOLINT
+    for (long p = 0; p < size; ++p)                                    // NOLINT
+      if (pareto_dominated_count_[p] == 0) front.push_back(p);
+    for (long r = 0; !front.empty(); ++r) {                            // NOLINT
+      for (long m = 0; m < M; ++m) {                                   // NOLINT
+        std::sort(front.begin(), front.end(), [&](long a, long b) {    // NOLINT
+            if (f[a * M + m] == f[b * M + m]) return a < b;
+            return f[a * M + m] < f[b * M + m];
+          });
+        const double range = f[front.back() * M + m] - f[front.front() * M + m];
+        crowding[front.front()] = crowding[front.back()] = HUGE_VAL;
+        if (!(range > 0.0)) continue;
+        for (unsigned long n = 1; n + 1 < front.size(); ++n)           // NOLINT
+          crowding[front[n]] += (f[front[n + 1] * M + m]
+                                 - f[front[n - 1] * M + m]) / range;
+      }
+      next_front.clear();
+      for (long p : front) {                                           // NOLINT
+        rank[p] = r;
+        for (long q : pareto_dominated_[p])                           // NOLINT
+          if (--pareto_dominated_count_[q] == 0) next_front.push_back(q);
+      }
+      front.swap(next_front);
+    }
+    return kDone;
+  }  // end of int SubPopulation::SortFronts()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetParetoScore(const std::vector<double> &objectives,
+                                    std::vector<double> *fitness) {
+    SortFronts(objectives, subpopulation_, &pareto_rank_, &pareto_crowding_);
+    fitness->resize(subpopulation_);
+    for (long i = 0; i < subpopulation_; ++i) {                        // NOLINT
+      double score = pareto_rank_[i] + 1.0 / (2.0 + pareto_crowding_[i]);
+      (*fitness)[i] = is_find_minimum_ ? score : -score;
+    }
+    return kDone;
+  }  // end of int SubPopulation::SetParetoScore()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Search direction is -H g for inverse Hessian approximation H,
+  /// components at active bounds are fixed. Line search is done in
+  /// parallel: steps alpha = 2, 1, 1/2, ... along the direction
+  /// projected to bounds are evaluated as a single batch and the best
+  /// one is taken. Until the first update (and after a failed line
+  /// search) H is replaced with steepest descent of the previous step
+  /// size, the first step size is the population diameter.
+  int SubPopulation::PolishBest(long max_evaluations, double tolerance) { // NOLINT
+    if (max_evaluations < 1 || tolerance < 0.0) {
+      error_status_ = kError;
+      return kError;
+    }
+    if (objectives_number_ > 0)
+      throw std::invalid_argument("Pareto front can not be polished!");
+    const long D = dimension_, kSteps = 8;                             // NOLINT
+    polish_evaluations_ = 0;
+    const long best = sorted_individuals_.front();                    // NOLINT
+    std::vector<double> x = x_vectors_current_.GetRow(best);
+    const double sign = is_find_minimum_ ? 1.0 : -1.0;
+    const double initial_f = sign * evaluated_fitness_for_current_vectors_[best];
+    double f = initial_f;
+    double step = GetPopulationDiameter();
+    double min_step = 0.0;
+    for (long j = 0; j < D; ++j)                                       // NOLINT
+      min_step = std::max(min_step, x_ubound_[j] - x_lbound_[j]);
+    if (!(step > 0.0)) step = 1e-3 * min_step;
+    // Steps below finite difference resolution are not tried.
+    min_step *= 1e-2 * kPolishStep;
+    std::vector<double> g, g_new, g_free, d(D), s(D), y(D), Hy(D);
+    // Empty until the first update.
+    std::vector<double> H;
+    if (2 * D > max_evaluations) return kDone;
+    GetPolishGradient(x, &g);
+    while (polish_evaluations_ + kSteps + 2 * D <= max_evaluations) {
+      double g_max = 0.0;
+      g_free = g;
+      for (long j = 0; j < D; ++j) {                                   // NOLINT
+        if ((x[j] <= x_lbound_[j] && g[j] > 0.0)
+            || (x[j] >= x_ubound_[j] && g[j] < 0.0)) g_free[j] = 0.0;
+        g_max = std::max(g_max, std::abs(g_free[j]));
+      }
+      if (!(g_max > 0.0)) break;
+      double slope = 0.0;
+      for (long j = 0; j < D; ++j) {                                   // NOLINT
+        if (H.empty()) {
+          d[j] = -g_free[j] * step / g_max;
+        } else {
+          d[j] = 0.0;
+          for (long k = 0; k < D; ++k) d[j] -= H[j * D + k] * g_free[k]; // NOLINT
+          if (g_free[j] == 0.0 && g[j] != 0.0) d[j] = 0.0;
+        }
+        slope += g_free[j] * d[j];
+      }
+      if (!(slope < 0.0)) {
+        H.clear();
+        continue;
+      }
+      polish_x_.resize(kSteps);
+      double alpha = 2.0;
+      for (long n = 0; n < kSteps; ++n, alpha *= 0.5) {                // NOLINT
+        polish_x_[n].resize(D);
+        for (long j = 0; j < D; ++j)                                   // NOLINT
+          polish_x_[n][j] = std::min(x_ubound_[j], std::max(
+              x_lbound_[j], x[j] + alpha * d[j]));
+      }
+      EvaluatePolishBatch(polish_x_, &polish_fitness_);
+      const long n_best = std::min_element(polish_fitness_.begin(),    // NOLINT
+                                           polish_fitness_.end())
+        - polish_fitness_.begin();
+      if (!(polish_fitness_[n_best] < f)) {
+        // Next batch continues with smaller steps.
+        if (H.empty()) step *= alpha;
+        if (step < min_step) break;
+        H.clear();
+        continue;
+      }
+      step = 0.0;
+      for (long j = 0; j < D; ++j) {                                   // NOLINT
+        s[j] = polish_x_[n_best][j] - x[j];
+        step = std::max(step, std::abs(s[j]));
+      }
+      x = polish_x_[n_best];
+      const double previous_f = f;
+      f = polish_fitness_[n_best];
+      if (std::abs(previous_f - f) <= tolerance * std::abs(f)) break;
+      GetPolishGradient(x, &g_new);
+      double sy = 0.0, yy = 0.0, ss = 0.0;
+      for (long j = 0; j < D; ++j) {                                   // NOLINT
+        y[j] = g_new[j] - g[j];
+        sy += s[j] * y[j];
+        yy += y[j] * y[j];
+        ss += s[j] * s[j];
+      }
+      g.swap(g_new);
+      // Curvature condition keeps H positive definite.
+      if (!(sy > 1e-12 * std::sqrt(ss * yy))) continue;
+      if (H.empty()) {
+        H.assign(D * D, 0.0);
+        for (long j = 0; j < D; ++j) H[j * D + j] = sy / yy;           // NOLINT
+      }
+      double yHy = 0.0;
+      for (long j = 0; j < D; ++j) {                                   // NOLINT
+        Hy[j] = 0.0;
+        for (long k = 0; k < D; ++k) Hy[j] += H[j * D + k] * y[k];     // NOLINT
+        yHy += y[j] * Hy[j];
+      }
+      const double rho = 1.0 / sy;
+      for (long j = 0; j < D; ++j)                                     // NOLINT
+        for (long k = 0; k < D; ++k)                                   // NOLINT
+          H[j * D + k] += rho * ((1.0 + rho * yHy) * s[j] * s[k]
+                                 - Hy[j] * s[k] - s[j] * Hy[k]);
+    }  // end of quasi-Newton iterations
+    if (f < initial_f) {
+      std::copy(x.begin(), x.end(), x_vectors_current_[best]);
+      evaluated_fitness_for_current_vectors_[best] = sign * f;
+    }
+    return kDone;
+  }  // end of int SubPopulation::PolishBest()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::EvaluatePolishBatch(
+      const std::vector<std::vector<double> > &x,
+      std::vector<double> *fitness) {
+    polish_evaluations_ += x.size();
+    if ((distribution_level_ == 1 || distribution_level_ == 3)
+        && number_of_processes_ > 1) {
+      const long size = x.size();                                      // NOLINT
+      const long share = (size + number_of_processes_ - 1)            // NOLINT
+        / number_of_processes_;
+      const long first = std::min(process_rank_ * share, size);        // NOLINT
+      const long last = std::min(first + share, size);                 // NOLINT
+      polish_local_x_.assign(x.begin() + first, x.begin() + last);
+      EvaluateBatchUncached(polish_local_x_, &polish_local_fitness_);
+      // Shares are gathered in rank order.
+      AllGatherVariableVectorDouble(polish_local_fitness_);
+      *fitness = recieve_double_;
+    } else {
+      EvaluateBatchUncached(x, fitness);
+    }
+    if (!is_find_minimum_)
+      for (double &value : *fitness) value = -value;
+    return kDone;
+  }  // end of int SubPopulation::EvaluatePolishBatch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::GetPolishGradient(const std::vector<double> &x,
+                                       std::vector<double> *gradient) {
+    const long D = dimension_;                                         // NOLINT
+    polish_x_.resize(2 * D);
+    for (long j = 0; j < D; ++j) {                                     // NOLINT
+      const double h = kPolishStep * (x_ubound_[j] - x_lbound_[j]);
+      polish_x_[2 * j] = x;
+      polish_x_[2 * j][j] = std::min(x[j] + h, x_ubound_[j]);
+      polish_x_[2 * j + 1] = x;
+      polish_x_[2 * j + 1][j] = std::max(x[j] - h, x_lbound_[j]);
+    }
+    EvaluatePolishBatch(polish_x_, &polish_fitness_);
+    gradient->resize(D);
+    for (long j = 0; j < D; ++j) {                                     // NOLINT
+      const double dx = polish_x_[2 * j][j] - polish_x_[2 * j + 1][j];
+      (*gradient)[j] = dx > 0.0
+        ? (polish_fitness_[2 * j] - polish_fitness_[2 * j + 1]) / dx : 0.0;
+    }
+    return kDone;
+  }  // end of int SubPopulation::GetPolishGradient()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::StartMigration() {
+    PhaseTimer timer(&phase_time_[kCommunicate]);
+    if (number_of_processes_ < 2) return kDone;
+    const long migrants = std::min(migration_size_, subpopulation_);   // NOLINT
+    const long record_size = dimension_ + 1;                           // NOLINT
+    migration_send_.resize(migrants * record_size + 2);
+    migration_recieve_.resize(migration_send_.size());
+    auto record = migration_send_.begin();
+    for (long n = 0; n < migrants; ++n) {                              // NOLINT
+      const long i = sorted_individuals_[n];                           // NOLINT
+      record = std::copy(x_vectors_current_[i],
+                         x_vectors_current_[i] + dimension_, record);
+      *(record++) = evaluated_fitness_for_current_vectors_[i];
+    }  // end of packing best individuals
+    migration_send_[migrants * record_size] = adaptor_mutation_mu_F_;
+    migration_send_[migrants * record_size + 1] = adaptor_crossover_mu_CR_;
+    // Ring of processes, for random topology the ring is shuffled in
+    // the same way on all processes.
+    std::vector<int> ring(number_of_processes_);
+    for (int r = 0; r < number_of_processes_; ++r) ring[r] = r;
+    if (isRandomTopology_)
+      std::shuffle(ring.begin(), ring.end(), migration_generator_);
+    const int position = std::find(ring.begin(), ring.end(), process_rank_)
+      - ring.begin();
+    const int target = ring[(position + 1) % number_of_processes_];
+    const int source = ring[(position + number_of_processes_ - 1)
+                            % number_of_processes_];
+    communicator_->StartExchange(migration_send_, target, &migration_recieve_,
+                                 source, kMigrationTag);
+    isMigrationPending_ = true;
+    return kDone;
+  }  // end of int SubPopulation::StartMigration()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::FinishMigration() {
+    PhaseTimer timer(&phase_time_[kCommunicate]);
+    communicator_->FinishExchange();
+    isMigrationPending_ = false;
+    const long record_size = dimension_ + 1;                           // NOLINT
+    const long migrants = (migration_recieve_.size() - 2) / record_size; // NOLINT
+    auto record = migration_recieve_.begin();
+    std::vector<double> &fitness = evaluated_fitness_for_current_vectors_;
+    std::vector<long> worst = sorted_individuals_;                     // NOLINT
+    std::partial_sort(worst.begin(), worst.begin() + migrants, worst.end(),
+                      [&](long a, long b) {                            // NOLINT
+                        return IsBetter(fitness[b], fitness[a]);
+                      });
+    for (long n = 0; n < migrants; ++n) {                              // NOLINT
+      std::copy(record, record + dimension_,
+                x_vectors_current_[worst[n]]);
+      fitness[worst[n]] = record[dimension_];
+      record += record_size;
+    }  // end of replacing worst individuals
+    if (isMigrateAdaptors_) {
+      const double mu_F = migration_recieve_[migrants * record_size];
+      const double mu_CR = migration_recieve_[migrants * record_size + 1];
+      adaptor_mutation_mu_F_ = (adaptor_mutation_mu_F_ + mu_F)/2;
+      adaptor_crossover_mu_CR_ = (adaptor_crossover_mu_CR_ + mu_CR)/2;
+    }
+    SortEvaluatedCurrent();
+    return kDone;
+  }  // end of int SubPopulation::FinishMigration()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void SubPopulation::SetAllBoundsVectors
+  (std::vector<double> lbound, std::vector<double> ubound) {
+    x_lbound_.clear();
+    x_ubound_.clear();    
+    for (auto x : lbound) x_lbound_.push_back(x);
+    for (auto x : ubound) x_ubound_.push_back(x);
+  }
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
@@ -604,6 +2647,144 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  void SubPopulation::SetSeed(unsigned long seed) {                  // NOLINT
+    std::seed_seq sequence {static_cast<std::uint64_t>(seed),
+          static_cast<std::uint64_t>(process_rank_)};
+    generator_.seed(sequence);
+    random_batch_generator_.Seed(seed, process_rank_);
+  }  // end of void SubPopulation::SetSeed(unsigned long seed)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetCheckpoint(std::string file_name, long interval) { // NOLINT
+    if (interval < 0 || (interval > 0 && file_name.empty())) {
+      error_status_ = kError;
+      return kError;
+    }
+    checkpoint_name_ = file_name;
+    checkpoint_interval_ = interval;
+    return kDone;
+  }  // end of int SubPopulation::SetCheckpoint()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::string SubPopulation::GetProcessFileName(std::string file_name) {
+    return file_name + "." + std::to_string(process_rank_);
+  }  // end of std::string SubPopulation::GetProcessFileName()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// Checkpoint is written to temporary file and renamed, so a job
+  /// killed during writing keeps the previous checkpoint.
+  int SubPopulation::WriteCheckpoint() {
+    PhaseTimer timer(&phase_time_[kCheckpoint]);
+    std::ostringstream generator_state, migration_generator_state;
+    generator_state << generator_;
+    migration_generator_state << migration_generator_;
+    CheckpointHeader header;
+    std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+    header.dimension = dimension_;
+    header.subpopulation = subpopulation_;
+    header.archive_size = archive_size_;
+    header.generation = current_generation_;
+    header.mu_F = adaptor_mutation_mu_F_;
+    header.mu_CR = adaptor_crossover_mu_CR_;
+    random_batch_generator_.GetState(header.random_batch_state);
+    header.generator_state_size = generator_state.str().size();
+    header.migration_generator_state_size =
+      migration_generator_state.str().size();
+    const std::string fname = GetProcessFileName(checkpoint_name_);
+    const std::string fname_tmp = fname + ".tmp";
+    FILE *fp = fopen(fname_tmp.c_str(), "wb");
+    if (fp == nullptr) {
+      error_status_ = kError;
+      return kError;
+    }
+    bool is_written = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (long i = 0; i < subpopulation_; ++i)                          // NOLINT
+      is_written &= fwrite(x_vectors_current_[i], sizeof(double), dimension_,
+                           fp) == static_cast<std::size_t>(dimension_);
+    is_written &= fwrite(&evaluated_fitness_for_current_vectors_.front(),
+                         sizeof(double), subpopulation_, fp)
+      == static_cast<std::size_t>(subpopulation_);
+    for (long i = 0; i < archive_size_; ++i)                           // NOLINT
+      is_written &= fwrite(GetArchived(i), sizeof(double), dimension_,
+                           fp) == static_cast<std::size_t>(dimension_);
+    is_written &= fputs(generator_state.str().c_str(), fp) >= 0;
+    is_written &= fputs(migration_generator_state.str().c_str(), fp) >= 0;
+    is_written &= fclose(fp) == 0;
+    if (!is_written || std::rename(fname_tmp.c_str(), fname.c_str()) != 0) {
+      error_status_ = kError;
+      return kError;
+    }
+    return kDone;
+  }  // end of int SubPopulation::WriteCheckpoint()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::RestoreCheckpoint(std::string file_name) {
+    // Asynchronous master has no generation state to continue from.
+    if (distribution_level_ == 3) return kError;
+    const std::string fname = GetProcessFileName(file_name);
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) return kError;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0
+        || file_stat.st_size < static_cast<off_t>(sizeof(CheckpointHeader))) {
+      close(fd);
+      return kError;
+    }
+    const long file_size = file_stat.st_size;                          // NOLINT
+    void *mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return kError;
+    const char *data = static_cast<const char*>(mapped);
+    CheckpointHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const long expected_size = sizeof(header)                          // NOLINT
+      + sizeof(double) * ((header.subpopulation + header.archive_size)
+                          * header.dimension + header.subpopulation)
+      + header.generator_state_size + header.migration_generator_state_size;
+    if (std::memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) != 0
+        || header.dimension != dimension_
+        || header.subpopulation < 1
+        || header.subpopulation > total_population_
+        || header.archive_size > header.subpopulation
+        || expected_size != file_size) {
+      munmap(mapped, file_size);
+      throw std::invalid_argument("Checkpoint does not match population!");
+    }
+    const double *values = reinterpret_cast<const double*>(data + sizeof(header));
+    // Size differs from Init() one if population was reduced.
+    SetPopulationSize(header.subpopulation);
+    for (long i = 0; i < subpopulation_; ++i, values += dimension_)
+      std::copy(values, values + dimension_, x_vectors_current_[i]);
+    evaluated_fitness_for_current_vectors_.assign(values,
+                                                  values + subpopulation_);
+    values += subpopulation_;
+    archived_best_A_.Resize(2 * total_population_, dimension_);
+    archive_size_ = header.archive_size;
+    for (long i = 0; i < archive_size_; ++i, values += dimension_)     // NOLINT
+      std::copy(values, values + dimension_, GetArchived(i));
+    const char *states = reinterpret_cast<const char*>(values);
+    std::istringstream generator_state(
+        std::string(states, header.generator_state_size));
+    generator_state >> generator_;
+    std::istringstream migration_generator_state(
+        std::string(states + header.generator_state_size,
+                    header.migration_generator_state_size));
+    migration_generator_state >> migration_generator_;
+    munmap(mapped, file_size);
+    random_batch_generator_.SetState(header.random_batch_state);
+    adaptor_mutation_mu_F_ = header.mu_F;
+    adaptor_crossover_mu_CR_ = header.mu_CR;
+    current_generation_ = header.generation;
+    isRestored_ = true;
+    return kDone;
+  }  // end of int SubPopulation::RestoreCheckpoint()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   int SubPopulation::SetBestShareP(double p) {
     if (p < 0 || p > 1) {
       error_status_ = kError;
@@ -627,6 +2808,10 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::SetDistributionLevel(int level) {
+    if (level < 0 || level > 3) {
+      error_status_ = kError;
+      return kError;
+    }
     distribution_level_ = level;
     return kDone;
   }
@@ -634,6 +2819,386 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  int SubPopulation::SetNumberOfThreads(int threads) {
+    if (threads < 1) {
+      error_status_ = kError;
+      return kError;
+    }
+    if (threads == 1) {
+      thread_pool_.reset();
+      return kDone;
+    }
+    if (!thread_pool_) thread_pool_.reset(new ThreadPool);
+    thread_pool_->Resize(threads);
+    return kDone;
+  }  // end of int SubPopulation::SetNumberOfThreads(int threads)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetFitnessCache(long capacity, double resolution, // NOLINT
+                                     bool isShared) {
+    if (capacity < 0 || !(resolution > 0.0) || dimension_ < 1) {
+      error_status_ = kError;
+      return kError;
+    }
+    isCacheShared_ = isShared;
+    if (capacity == 0) {
+      fitness_cache_.reset();
+      return kDone;
+    }
+    if (!fitness_cache_) fitness_cache_.reset(new FitnessCache);
+    fitness_cache_->Init(capacity, dimension_, resolution);
+    return kDone;
+  }  // end of int SubPopulation::SetFitnessCache()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetRestarts(long restarts, double population_factor, // NOLINT
+                                 long elites) {                        // NOLINT
+    if (restarts < 0 || !(population_factor >= 1.0)
+        || (restarts > 0 && elites < 1)) {
+      // Without elites the best vector of previous runs is lost.
+      error_status_ = kError;
+      return kError;
+    }
+    restarts_max_ = restarts;
+    restart_population_factor_ = population_factor;
+    elites_max_ = elites;
+    return kDone;
+  }  // end of int SubPopulation::SetRestarts()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::vector<std::vector<double> > SubPopulation::GetElites(
+      std::vector<double> *fitness) {
+    std::vector<std::vector<double> > x;
+    fitness->clear();
+    for (const auto &elite : elites_) {
+      fitness->push_back(elite.first);
+      x.push_back(elite.second);
+    }
+    return x;
+  }  // end of std::vector<std::vector<double> > SubPopulation::GetElites()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::UpdateElites() {
+    const std::vector<long> sorted = GetSortedIndividuals();           // NOLINT
+    const long size = std::min(elites_max_, subpopulation_);           // NOLINT
+    std::vector<double> local, all;
+    for (long k = 0; k < size; ++k) {
+      local.push_back(evaluated_fitness_for_current_vectors_[sorted[k]]);
+      local.insert(local.end(), x_vectors_current_[sorted[k]],
+                   x_vectors_current_[sorted[k]] + dimension_);
+    }
+    // Islands share their elites, other levels have either the same
+    // population on all processes or independent runs.
+    if (distribution_level_ == 2) {
+      PhaseTimer timer(&phase_time_[kCommunicate]);
+      communicator_->AllGatherVariable(local, &all);
+    } else {
+      all.swap(local);
+    }
+    for (std::size_t i = 0; i < all.size(); i += dimension_ + 1) {
+      std::vector<double> x(all.begin() + i + 1,
+                            all.begin() + i + 1 + dimension_);
+      bool isKnown = false;
+      for (const auto &elite : elites_) isKnown |= elite.second == x;
+      if (!isKnown) elites_.emplace_back(all[i], x);
+    }
+    // Ties are resolved by vectors to have the same order on all
+    // processes.
+    std::sort(elites_.begin(), elites_.end(),
+              [&](const std::pair<double, std::vector<double> > &a,
+                  const std::pair<double, std::vector<double> > &b) {
+                if (a.first == b.first) return a.second < b.second;
+                return IsBetter(a.first, b.first);
+              });
+    if (static_cast<long>(elites_.size()) > elites_max_)              // NOLINT
+      elites_.resize(elites_max_);
+    return kDone;
+  }  // end of int SubPopulation::UpdateElites()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::ResizePopulation(long size) {                    // NOLINT
+    total_population_ = size;
+    subpopulation_ = size;
+    x_vectors_current_.Resize(subpopulation_, dimension_);
+    x_vectors_next_generation_.Resize(subpopulation_, dimension_);
+    mutation_F_.resize(subpopulation_);
+    crossover_CR_.resize(subpopulation_);
+    return SetPopulationSize(subpopulation_);
+  }  // end of int SubPopulation::ResizePopulation()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetStagnationStop(double tolerance,
+                                       long generations) {             // NOLINT
+    if (tolerance < 0.0 || generations < 0) {
+      error_status_ = kError;
+      return kError;
+    }
+    stagnation_tolerance_ = tolerance;
+    stagnation_generations_ = generations;
+    best_fitness_history_.resize(generations + 1);
+    return kDone;
+  }  // end of int SubPopulation::SetStagnationStop()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetDiameterStop(double tolerance) {
+    if (tolerance < 0.0) {
+      error_status_ = kError;
+      return kError;
+    }
+    diameter_tolerance_ = tolerance;
+    return kDone;
+  }  // end of int SubPopulation::SetDiameterStop()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetBudgetStop(double seconds, long evaluations) { // NOLINT
+    if (seconds < 0.0 || evaluations < 0) {
+      error_status_ = kError;
+      return kError;
+    }
+    budget_seconds_ = seconds;
+    budget_evaluations_ = evaluations;
+    return kDone;
+  }  // end of int SubPopulation::SetBudgetStop()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetPopulationReduction(long minimum) {            // NOLINT
+    // Mutation needs current, p-best and two random individuals.
+    const long kMinimum = 4;                                           // NOLINT
+    if (minimum != 0 && (minimum < kMinimum || minimum > total_population_)) {
+      error_status_ = kError;
+      return kError;
+    }
+    population_minimum_ = minimum;
+    return kDone;
+  }  // end of int SubPopulation::SetPopulationReduction()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetSurrogate(double evaluated_share,
+                                  long neighbours, double max_error) { // NOLINT
+    // Radial basis function model needs at least two points.
+    if (!(evaluated_share > 0.0) || evaluated_share > 1.0 || neighbours < 2
+        || max_error < 0.0) {
+      error_status_ = kError;
+      return kError;
+    }
+    surrogate_share_ = evaluated_share;
+    surrogate_neighbours_ = neighbours;
+    surrogate_max_error_ = max_error;
+    surrogate_error_ = 0.0;
+    surrogate_generations_ = 0;
+    isSurrogate_ = evaluated_share < 1.0;
+    return kDone;
+  }  // end of int SubPopulation::SetSurrogate()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetObjectives(long number) {                      // NOLINT
+    if (number < 0) {
+      error_status_ = kError;
+      return kError;
+    }
+    objectives_number_ = number;
+    return kDone;
+  }  // end of int SubPopulation::SetObjectives()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetTelemetry(std::string file_name) {
+    telemetry_name_ = file_name;
+    return kDone;
+  }  // end of int SubPopulation::SetTelemetry()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::StartTelemetry() {
+    StopTelemetry();
+    // Asynchronous workers have no generations to report.
+    if (distribution_level_ == 3 && process_rank_ != kOutput) return kDone;
+    if (!dump_name_.empty() && (distribution_level_ == 0
+                                || distribution_level_ == 2
+                                || process_rank_ == kOutput)) {
+      if (!dump_writer_) dump_writer_.reset(new stream_writer::StreamWriter);
+      try {
+        dump_writer_->Open(GetProcessFileName(dump_name_),
+                           isRestored_ || restart_ > 0);
+      } catch (const std::invalid_argument &) {
+        error_status_ = kError;
+        return kError;
+      }
+    }
+    if (telemetry_name_.empty()) return kDone;
+    // Restored run continues the telemetry of interrupted one.
+    telemetry_file_ = fopen(GetProcessFileName(telemetry_name_).c_str(),
+                            isRestored_ || restart_ > 0 ? "a" : "w");
+    if (telemetry_file_ == nullptr) {
+      error_status_ = kError;
+      return kError;
+    }
+    return kDone;
+  }  // end of int SubPopulation::StartTelemetry()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::StartGenerationTelemetry() {
+    for (double &time : phase_time_) time = 0.0;
+    generation_start_time_ = Communicator::GetTime();
+    generation_start_evaluations_ = evaluations_;
+    generation_start_failed_ = failed_evaluations_;
+    generation_start_hits_ = GetFitnessCacheHits();
+    return kDone;
+  }  // end of int SubPopulation::StartGenerationTelemetry()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::WriteTelemetry() {
+    if (dump_writer_ && dump_writer_->IsOpen()
+        && current_generation_ % dump_interval_ == 0)
+      WritePopulationDump();
+    if (telemetry_file_ == nullptr) return kDone;
+    const double time = Communicator::GetTime() - generation_start_time_;
+    double evolve = time;
+    for (double phase : phase_time_) evolve -= phase;
+    fprintf(telemetry_file_, "{\"generation\": %li, \"restart\": %li, "
+            "\"population\": %li, \"time\": %.6e, \"evaluate\": %.6e, "
+            "\"evolve\": %.6e, \"archive\": %.6e, \"communicate\": %.6e, "
+            "\"checkpoint\": %.6e, \"evaluations\": %li, \"failed\": %li, "
+            "\"cache_hits\": %li, \"screened\": %li, \"best\": %.17g, "
+            "\"mu_F\": %.17g, \"mu_CR\": %.17g}\n",
+            current_generation_, restart_, subpopulation_, time,
+            phase_time_[kEvaluate], evolve, phase_time_[kArchive],
+            phase_time_[kCommunicate], phase_time_[kCheckpoint],
+            evaluations_ - generation_start_evaluations_,
+            failed_evaluations_ - generation_start_failed_,
+            GetFitnessCacheHits() - generation_start_hits_, screened_trials_,
+            evaluated_fitness_for_current_vectors_[sorted_individuals_[0]],
+            adaptor_mutation_mu_F_, adaptor_crossover_mu_CR_);
+    fflush(telemetry_file_);
+    return kDone;
+  }  // end of int SubPopulation::WriteTelemetry()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::StopTelemetry() {
+    if (telemetry_file_ != nullptr) fclose(telemetry_file_);
+    telemetry_file_ = nullptr;
+    if (dump_writer_ && !dump_writer_->Close()) error_status_ = kError;
+    return kDone;
+  }  // end of int SubPopulation::StopTelemetry()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetPopulationDump(std::string file_name,
+                                       long interval) {                // NOLINT
+    if (!file_name.empty() && interval < 1) {
+      error_status_ = kError;
+      return kError;
+    }
+    dump_name_ = file_name;
+    dump_interval_ = interval;
+    return kDone;
+  }  // end of int SubPopulation::SetPopulationDump()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::WritePopulationDump() {
+    for (long i = 0; i < subpopulation_; ++i) {
+      const double row[] = {static_cast<double>(current_generation_),
+                            static_cast<double>(i),
+                            evaluated_fitness_for_current_vectors_[i]};
+      dump_writer_->Write(row, sizeof(row));
+      dump_writer_->Write(x_vectors_current_[i], dimension_*sizeof(double));
+    }
+    return kDone;
+  }  // end of int SubPopulation::WritePopulationDump()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool SubPopulation::IsStopCriterion() {
+    const bool isConvergenceSet =
+      stagnation_generations_ > 0 || diameter_tolerance_ > 0.0;
+    const bool isBudgetSet = budget_seconds_ > 0.0 || budget_evaluations_ > 0;
+    isConverged_ = false;
+    if (!isConvergenceSet && !isBudgetSet) return false;
+    bool isConverged = false;
+    // Best individual of a Pareto front is only the least crowded one.
+    if (stagnation_generations_ > 0 && objectives_number_ == 0) {
+      const long size = stagnation_generations_ + 1;                   // NOLINT
+      const std::vector<double> &fitness = evaluated_fitness_for_current_vectors_;
+      double best = fitness[sorted_individuals_[0]];
+      if (!isFedElite_.empty()) {
+        bool isFirst = true;
+        for (long i = 0; i < subpopulation_; ++i) {                    // NOLINT
+          if (isFedElite_[i]) continue;
+          if (isFirst || IsBetter(fitness[i], best)) best = fitness[i];
+          isFirst = false;
+        }
+      }
+      best_fitness_history_[current_generation_ % size] = best;
+      if (best_fitness_history_size_ < size) ++best_fitness_history_size_;
+      else isConverged = std::abs(best - best_fitness_history_[
+          (current_generation_ + 1) % size]) < stagnation_tolerance_;
+    }
+    if (diameter_tolerance_ > 0.0)
+      isConverged |= GetPopulationDiameter() < diameter_tolerance_;
+    int is_exhausted = 0;
+    if (budget_seconds_ > 0.0 && Communicator::GetTime() - start_time_ > budget_seconds_)
+      is_exhausted = 1;
+    if (budget_evaluations_ > 0 && evaluations_ >= budget_evaluations_)
+      is_exhausted = 1;
+    // Asynchronous model is controlled by a single process.
+    if (distribution_level_ == 3) {
+      isConverged_ = is_exhausted == 0 && isConverged;
+      return is_exhausted == 1 || isConverged;
+    }
+    // Single reduction for both decisions: any process is exhausted
+    // or any process has not converged.
+    int local[2] = {is_exhausted, isConverged ? 0 : 1};
+    int global[2];
+    PhaseTimer timer(&phase_time_[kCommunicate]);
+    communicator_->AllReduceMax(local, 2, global);
+    isConverged_ = global[0] == 0 && global[1] == 0;
+    return global[0] == 1 || global[1] == 0;
+  }  // end of bool SubPopulation::IsStopCriterion()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  double SubPopulation::GetPopulationDiameter() {
+    double diameter = 0.0;
+    for (long c = 0; c < dimension_; ++c) {                            // NOLINT
+      double min = x_vectors_current_[0][c], max = min;
+      for (long i = 1; i < subpopulation_; ++i) {                      // NOLINT
+        min = std::min(min, x_vectors_current_[i][c]);
+        max = std::max(max, x_vectors_current_[i][c]);
+      }
+      diameter = std::max(diameter, max - min);
+    }
+    return diameter;
+  }  // end of double SubPopulation::GetPopulationDiameter()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  int SubPopulation::SetMigration(long interval, long size) {        // NOLINT
+    if (interval < 1 || size < 1) {
+      error_status_ = kError;
+      return kError;
+    }
+    migration_interval_ = interval;
+    migration_size_ = size;
+    return kDone;
+  }  // end of int SubPopulation::SetMigration(long interval, long size)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   int SubPopulation::PrintParameters(std::string comment) {
     if (process_rank_ == 0) {
       printf("#%s dim=%li NP=%li(of %li) p=%4.2f c=%4.2f generation=%li\n",
@@ -648,25 +3213,20 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   int SubPopulation::PrintResult(std::string comment) {    
-    if (distribution_level_ == 0) {      
-      auto x = evaluated_fitness_for_current_vectors_.front();
-      std::vector<double> to_send {x.first};
-      //printf("%8.5g\n  ", x.first);
-      AllGatherVectorDouble(to_send);
-      if (process_rank_ == 0) {
-        double sum = 0;
-        double size = static_cast<double>(recieve_double_.size());
-        for (auto x : recieve_double_) sum += x;
-        double mean = sum/size;
-        double sigma = 0;
-        for (auto x : recieve_double_) sigma += pow2(x - mean);
-        sigma = sqrt(sigma/size);
-        printf("%s gen%li, mean %4.1e (stddev %4.1e = %3.2g %%) runs(%g)\n",
-               comment.c_str(), total_generations_max_,  mean,sigma,
-               sigma*100.0/mean,size);
-        // for (auto x : recieve_double_)
-        //   printf("%18.15g\n", x);
-      }
+    GetFinalFitness();
+    if (process_rank_ == 0) {
+      double sum = 0;
+      double size = static_cast<double>(recieve_double_.size());
+      for (auto x : recieve_double_) sum += x;
+      double mean = sum/size;
+      double sigma = 0;
+      for (auto x : recieve_double_) sigma += pow2(x - mean);
+      sigma = sqrt(sigma/size);
+      printf("%s gen%li, mean %4.1e (stddev %4.1e = %3.2g %%) runs(%g)\n",
+             comment.c_str(), total_generations_max_,  mean,sigma,
+             sigma*100.0/mean,size);
+      // for (auto x : recieve_double_)
+      //   printf("%18.15g\n", x);
     }
     return kDone;
   }  // end of int SubPopulation::PrintResult()
@@ -675,9 +3235,12 @@ namespace jade {
   // ********************************************************************** //
   std::vector<double> SubPopulation::GetFinalFitness() {
     recieve_double_.clear();    
-    if (distribution_level_ == 0) {      
-      auto x = evaluated_fitness_for_current_vectors_.front();
-      std::vector<double> to_send {x.first};
+    std::vector<double> to_send
+        {evaluated_fitness_for_current_vectors_[sorted_individuals_.front()]};
+    if (distribution_level_ == 1 || distribution_level_ == 3) {
+      // All processes share the same population, it is a single run.
+      recieve_double_ = to_send;
+    } else {
       AllGatherVectorDouble(to_send);      
     }
     return recieve_double_;
@@ -686,45 +3249,91 @@ namespace jade {
   // ********************************************************************** //
   // ********************************************************************** //
   std::vector<double> SubPopulation::GetBest(double *best_fitness) {
-    auto x = evaluated_fitness_for_current_vectors_.front();
-    (*best_fitness) = x.first;
-    return x_vectors_current_[x.second];
+    const long best = sorted_individuals_.front();                    // NOLINT
+    (*best_fitness) = evaluated_fitness_for_current_vectors_[best];
+    return x_vectors_current_.GetRow(best);
   }  // end of std::vector<double> SubPopulation::GetBest(double *best_fitness)
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
   std::vector<double> SubPopulation::GetWorst(double *worst_fitness) {
-    auto x = evaluated_fitness_for_current_vectors_.back();
-    (*worst_fitness) = x.first;
-    return x_vectors_current_[x.second];
+    const std::vector<double> &fitness = evaluated_fitness_for_current_vectors_;
+    const long worst = std::min_element(                               // NOLINT
+        fitness.begin(), fitness.end(), [&](double a, double b) {
+          return IsBetter(b, a);
+        }) - fitness.begin();
+    (*worst_fitness) = fitness[worst];
+    return x_vectors_current_.GetRow(worst);
   }  // end of std::vector<double> SubPopulation::GetWorst(double *worst_fitness)
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  std::vector<std::vector<double> > SubPopulation::GetParetoFront(
+      std::vector<std::vector<double> > *objectives) {
+    std::vector<std::vector<double> > front;
+    objectives->clear();
+    const long M = objectives_number_;                                 // NOLINT
+    // Objectives are known after RunOptimization().
+    if (M == 0 || static_cast<long>(objectives_current_.size())       // NOLINT
+        != subpopulation_ * M) return front;
+    SortFronts(objectives_current_, subpopulation_, &pareto_rank_,
+               &pareto_crowding_);
+    pareto_index_.clear();
+    for (long i = 0; i < subpopulation_; ++i)                          // NOLINT
+      if (pareto_rank_[i] == 0) pareto_index_.push_back(i);
+    const std::vector<double> &f = objectives_current_;
+    std::sort(pareto_index_.begin(), pareto_index_.end(),
+              [&](long a, long b) {                                    // NOLINT
+                if (f[a * M] == f[b * M]) return a < b;
+                return f[a * M] < f[b * M];
+              });
+    for (long i : pareto_index_) {                                     // NOLINT
+      front.push_back(x_vectors_current_.GetRow(i));
+      objectives->push_back(std::vector<double>(f.begin() + i * M,
+                                                f.begin() + (i + 1) * M));
+    }
+    return front;
+  }  // end of std::vector<std::vector<double> > SubPopulation::GetParetoFront()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   int SubPopulation::AllGatherVectorDouble(std::vector<double> to_send) {
     long size_single = to_send.size();
     long size_all = size_single * number_of_processes_;
     recieve_double_.clear();
     recieve_double_.resize(size_all);
-    MPI_Allgather(&to_send.front(), size_single, MPI_DOUBLE,
-                  &recieve_double_.front(), size_single, MPI_DOUBLE,
-                  MPI_COMM_WORLD);
+    communicator_->AllGather(to_send.data(), size_single,
+                             recieve_double_.data());
     return kDone;
   }  // end of int SubPopulation::AllGatherVectorDouble(std::vector<double> to_send);
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  int SubPopulation::AllGatherVariableVectorDouble(
+      const std::vector<double> &to_send) {
+    communicator_->AllGatherVariable(to_send, &recieve_double_);
+    return kDone;
+  }  // end of int SubPopulation::AllGatherVariableVectorDouble()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
   int SubPopulation::AllGatherVectorLong(std::vector<long> to_send) {
     long size_single = to_send.size();
     long size_all = size_single * number_of_processes_;
     recieve_long_.clear();
     recieve_long_.resize(size_all);
-    MPI_Allgather(&to_send.front(), size_single, MPI_LONG,
-                  &recieve_long_.front(), size_single, MPI_LONG,
-                  MPI_COMM_WORLD);
+    communicator_->AllGather(to_send.data(), size_single,
+                             recieve_long_.data());
     return kDone;
   }  // end of int SubPopulation::AllGatherVectorLong(std::vector<long> to_send);
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
+  long SubPopulation::BroadcastLong(long value) {                    // NOLINT
+    communicator_->Broadcast(&value, 1, kOutput);
+    return value;
+  }  // end of long SubPopulation::BroadcastLong(long value)
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
 }  // end of namespace jade
@@ -31,13 +31,354 @@
 /// Evolution' in H. Deng et al. (Eds.): AICI 2011, Part II, LNAI
 /// 7003, pp. 34–41, 2011
 
+#ifdef JADE_WITH_MPI
+#include <mpi.h>
+#endif
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <utility>
 #include <list>
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include "./stream-writer/stream-writer.h"
 namespace jade {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Pool of threads to run a batch of independent tasks.
+  ///
+  /// Tasks are split into contiguous blocks, one block per thread. A
+  /// thread that has finished its own block steals tasks from blocks
+  /// of other threads, so tasks with very different run time are
+  /// balanced. Calling thread is used as one of the workers.
+  class ThreadPool {
+   public:
+    ~ThreadPool();
+    /// @brief Set total number of threads (including calling thread).
+    void Resize(int threads);
+    int Size() const {return static_cast<int>(workers_.size()) + 1;}
+    /// @brief Run task(n) for all n in [0, tasks) and wait for
+    /// completion. Exception from any task is rethrown.
+    void Run(long tasks, const std::function<void(long)> &task);     // NOLINT
+   private:
+    struct Block {
+      std::atomic<long> next;                                        // NOLINT
+      long end;                                                      // NOLINT
+    };
+    void Stop();
+    void WorkerLoop(int worker);
+    void Execute(int worker);
+    std::vector<std::thread> workers_;
+    std::unique_ptr<Block[]> blocks_;
+    std::mutex mutex_;
+    std::condition_variable start_, finish_;
+    long batch_ = 0;                                                  // NOLINT
+    int running_ = 0;
+    bool isStop_ = false;
+    const std::function<void(long)> *task_ = nullptr;                // NOLINT
+    std::exception_ptr exception_;
+  };  // end of class ThreadPool
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief State vectors stored row by row in a single buffer.
+  ///
+  /// Rows are aligned to 64 bytes and padded with zeros to a multiple
+  /// of kPadding doubles (AVX-512 vector width), so vectorized kernels
+  /// never split cache lines.
+  class PopulationMatrix {
+   public:
+    PopulationMatrix() {}
+    PopulationMatrix(const PopulationMatrix &other) {*this = other;}
+    PopulationMatrix& operator=(const PopulationMatrix &other);
+    void Resize(long rows, long columns);                            // NOLINT
+    void Swap(PopulationMatrix &other);
+    double* operator[](long row) {                                   // NOLINT
+      return &storage_[offset_ + row * stride_];
+    }
+    const double* operator[](long row) const {                       // NOLINT
+      return &storage_[offset_ + row * stride_];
+    }
+    std::vector<double> GetRow(long row) const {                     // NOLINT
+      return std::vector<double>((*this)[row], (*this)[row] + columns_);
+    }
+    long Rows() const {return rows_;}                                 // NOLINT
+    long Columns() const {return columns_;}                           // NOLINT
+    long Stride() const {return stride_;}                             // NOLINT
+    static const long kPadding = 8;                                   // NOLINT
+   private:
+    std::vector<double> storage_;
+    long offset_ = 0, rows_ = 0, columns_ = 0, stride_ = 0;           // NOLINT
+  };  // end of class PopulationMatrix
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Counter based random generator Philox4x32-10 from John
+  /// K. Salmon et al. 'Parallel random numbers: as easy as 1, 2, 3',
+  /// SC11, 2011.
+  ///
+  /// Each block of output depends only on key, stream and block
+  /// counter, so a batch is filled with independent iterations and
+  /// the sequence is reproduced from the (seed, stream, counter) state.
+  class CounterRandom {
+   public:
+    void Seed(std::uint64_t seed, std::uint64_t stream);
+    /// @brief Fill size uniform random values in [0, 1).
+    void FillUniform(double *uniform, long size);                    // NOLINT
+    double Uniform();
+    /// @brief Full state is seed, stream and counter.
+    void GetState(std::uint64_t state[3]) const;
+    void SetState(const std::uint64_t state[3]);
+   private:
+    std::uint32_t key_[2] = {0, 0};
+    std::uint32_t stream_[2] = {0, 0};
+    std::uint64_t counter_ = 0;
+  };  // end of class CounterRandom
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Bounded cache of evaluated fitness values.
+  ///
+  /// Input vectors are quantized with given resolution, so vectors
+  /// closer than resolution share one entry. Open addressing table
+  /// with linear probing limited to kProbe slots, when all of them
+  /// are used an entry is evicted with CLOCK (second chance) rule.
+  /// Not thread safe, should be used from a single thread.
+  class FitnessCache {
+   public:
+    /// @brief Capacity is rounded up to a power of two.
+    void Init(long capacity, long dimension, double resolution);     // NOLINT
+    void Clear();
+    bool Find(const std::vector<double> &x, double *fitness);
+    void Insert(const double *x, double fitness);
+    long Capacity() const {return capacity_;}                         // NOLINT
+    long Hits() const {return hits_;}                                 // NOLINT
+    long Misses() const {return misses_;}                             // NOLINT
+    static const long kProbe = 8;                                     // NOLINT
+   private:
+    /// @brief Quantize x into key_ and return its hash (never zero).
+    std::uint64_t Quantize(const double *x);
+    bool IsKeyInSlot(long slot) const;                                // NOLINT
+    /// @brief Zero hash marks empty slot.
+    std::vector<std::uint64_t> hash_;
+    std::vector<std::int64_t> keys_, key_;
+    std::vector<double> fitness_;
+    std::vector<char> reference_;
+    long capacity_ = 0, dimension_ = 0;                               // NOLINT
+    double resolution_ = 1e-11;
+    long hits_ = 0, misses_ = 0;                                      // NOLINT
+  };  // end of class FitnessCache
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Vectorized kernels (AVX-512, AVX2 or scalar fallback,
+  /// selected at compile time).
+  ///
+  /// DE/current-to-pbest/1 mutation with bounds control
+  /// v = x + F*(x_pbest - x) + F*(x_r1 - x_r2)
+  void MutationKernel(const double *x, const double *x_pbest,
+                      const double *x_r1, const double *x_r2,
+                      const double *lbound, const double *ubound,
+                      double F, long size, double *v);               // NOLINT
+  /// @brief Binomial crossover done in place, u = v where uniform < CR
+  /// or at j_rand, otherwise u = x.
+  void CrossoverKernel(const double *x, const double *uniform, double CR,
+                       long j_rand, long size, double *u);           // NOLINT
+  /// @brief Same kernels with size fixed at compile time, so loops
+  /// are fully unrolled and bounds control is branch free, size
+  /// argument is ignored. SubPopulation selects them in Init() for
+  /// dimension up to kFixedDimensionMax.
+  template<long D>                                                   // NOLINT
+  void MutationKernelFixed(const double *x, const double *x_pbest,
+                           const double *x_r1, const double *x_r2,
+                           const double *lbound, const double *ubound,
+                           double F, long size, double *v);          // NOLINT
+  template<long D>                                                   // NOLINT
+  void CrossoverKernelFixed(const double *x, const double *uniform,
+                            double CR, long j_rand, long size,       // NOLINT
+                            double *u);
+  const long kFixedDimensionMax = 10;                                // NOLINT
+  typedef void (*MutationKernelPointer)(
+      const double *x, const double *x_pbest, const double *x_r1,
+      const double *x_r2, const double *lbound, const double *ubound,
+      double F, long size, double *v);                               // NOLINT
+  typedef void (*CrossoverKernelPointer)(
+      const double *x, const double *uniform, double CR, long j_rand,
+      long size, double *u);                                         // NOLINT
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Group of ranks used by SubPopulation to exchange data.
+  ///
+  /// Collective operations should be called by all ranks of the group
+  /// in the same order. Backends are MPI processes (MpiCommunicator,
+  /// only if built with JADE_WITH_MPI), threads of a single process
+  /// (ThreadCommunicator) and a single rank (SerialCommunicator).
+  class Communicator {
+   public:
+    static const int kAnySource = -1;
+    static const int kAnyTag = -1;
+    virtual ~Communicator() {}
+    virtual int Rank() const = 0;
+    virtual int Size() const = 0;
+    /// @brief Each rank sends size values, receive gets Size()*size
+    /// values in rank order.
+    virtual void AllGather(const double *send, long size,              // NOLINT
+                           double *receive) = 0;
+    virtual void AllGather(const long *send, long size,                // NOLINT
+                           long *receive) = 0;                         // NOLINT
+    /// @brief Same as AllGather(), size of send may differ between
+    /// ranks, receive is resized.
+    virtual void AllGatherVariable(const std::vector<double> &send,
+                                   std::vector<double> *receive) = 0;
+    virtual void Broadcast(double *values, long size, int root) = 0;   // NOLINT
+    virtual void Broadcast(long *values, long size, int root) = 0;     // NOLINT
+    /// @brief Element-wise maximum over ranks.
+    virtual void AllReduceMax(const int *send, long size,              // NOLINT
+                              int *receive) = 0;
+    virtual void AllReduceMax(const double *send, long size,           // NOLINT
+                              double *receive) = 0;
+    virtual void Barrier() = 0;
+    virtual void Send(const std::vector<double> &message, int destination,
+                      int tag) = 0;
+    /// @brief Blocking receive of a message of any size, source and
+    /// tag may be kAnySource and kAnyTag. Returns source of the
+    /// message, its tag is written to received_tag if it is not null.
+    virtual int Receive(std::vector<double> *message, int source, int tag,
+                        int *received_tag) = 0;
+    /// @brief Start sending send to destination and receiving
+    /// receive->size() values from source, buffers should not be used
+    /// until FinishExchange(). Only one exchange may be pending.
+    virtual void StartExchange(const std::vector<double> &send,
+                               int destination, std::vector<double> *receive,
+                               int source, int tag) = 0;
+    virtual void FinishExchange() = 0;
+    /// @brief Wall clock time in seconds, same clock for all backends.
+    static double GetTime();
+  };  // end of class Communicator
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Single rank, collectives are copies. There is no one to
+  /// send messages to, except for exchange with itself.
+  class SerialCommunicator : public Communicator {
+   public:
+    int Rank() const {return 0;}
+    int Size() const {return 1;}
+    void AllGather(const double *send, long size, double *receive);     // NOLINT
+    void AllGather(const long *send, long size, long *receive);         // NOLINT
+    void AllGatherVariable(const std::vector<double> &send,
+                           std::vector<double> *receive);
+    void Broadcast(double * /*values*/, long /*size*/,                 // NOLINT
+                   int /*root*/) {}
+    void Broadcast(long * /*values*/, long /*size*/,                   // NOLINT
+                   int /*root*/) {}
+    void AllReduceMax(const int *send, long size, int *receive);       // NOLINT
+    void AllReduceMax(const double *send, long size, double *receive); // NOLINT
+    void Barrier() {}
+    void Send(const std::vector<double> &message, int destination, int tag);
+    int Receive(std::vector<double> *message, int source, int tag,
+                int *received_tag);
+    void StartExchange(const std::vector<double> &send, int destination,
+                       std::vector<double> *receive, int source, int tag);
+    void FinishExchange() {}
+  };  // end of class SerialCommunicator
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Ranks are threads of a single process, e.g. islands of
+  /// distribution level 2 each running its SubPopulation in its own
+  /// thread. Messages are copied to a mailbox of destination rank,
+  /// collectives exchange pointers to buffers of all ranks.
+  class ThreadCommunicator : public Communicator {
+   public:
+    /// @brief Communicators of all ranks of a new group, rank r
+    /// should be used by thread r only.
+    static std::vector<std::shared_ptr<Communicator> > CreateGroup(int size);
+    int Rank() const {return rank_;}
+    int Size() const;
+    void AllGather(const double *send, long size, double *receive);     // NOLINT
+    void AllGather(const long *send, long size, long *receive);         // NOLINT
+    void AllGatherVariable(const std::vector<double> &send,
+                           std::vector<double> *receive);
+    void Broadcast(double *values, long size, int root);               // NOLINT
+    void Broadcast(long *values, long size, int root);                 // NOLINT
+    void AllReduceMax(const int *send, long size, int *receive);       // NOLINT
+    void AllReduceMax(const double *send, long size, double *receive); // NOLINT
+    void Barrier();
+    void Send(const std::vector<double> &message, int destination, int tag);
+    int Receive(std::vector<double> *message, int source, int tag,
+                int *received_tag);
+    void StartExchange(const std::vector<double> &send, int destination,
+                       std::vector<double> *receive, int source, int tag);
+    void FinishExchange();
+   private:
+    struct Group;
+    ThreadCommunicator(std::shared_ptr<Group> group, int rank)
+        : group_(group), rank_(rank) {}
+    /// @brief Called with buffers of all ranks and their sizes.
+    typedef std::function<void(const std::vector<const void*> &buffers,
+                               const std::vector<long> &sizes)> Collect; // NOLINT
+    /// @brief Publish buffer of this rank, call collect and wait until
+    /// all ranks are done with buffers.
+    void Collective(const void *send, long size, const Collect &collect); // NOLINT
+    /// @brief Barrier with group mutex locked by lock.
+    void WaitAll(std::unique_lock<std::mutex> *lock);
+    std::shared_ptr<Group> group_;
+    int rank_;
+    /// @brief Pending exchange.
+    std::vector<double> *exchange_receive_ = nullptr;
+    int exchange_source_ = 0, exchange_tag_ = 0;
+  };  // end of class ThreadCommunicator
+#ifdef JADE_WITH_MPI
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief MPI processes of comm, MPI should be initialized before
+  /// construction and finalized after destruction.
+  class MpiCommunicator : public Communicator {
+   public:
+    explicit MpiCommunicator(MPI_Comm comm = MPI_COMM_WORLD);
+    int Rank() const {return rank_;}
+    int Size() const {return size_;}
+    void AllGather(const double *send, long size, double *receive);     // NOLINT
+    void AllGather(const long *send, long size, long *receive);         // NOLINT
+    void AllGatherVariable(const std::vector<double> &send,
+                           std::vector<double> *receive);
+    void Broadcast(double *values, long size, int root);               // NOLINT
+    void Broadcast(long *values, long size, int root);                 // NOLINT
+    void AllReduceMax(const int *send, long size, int *receive);       // NOLINT
+    void AllReduceMax(const double *send, long size, double *receive); // NOLINT
+    void Barrier();
+    void Send(const std::vector<double> &message, int destination, int tag);
+    int Receive(std::vector<double> *message, int source, int tag,
+                int *received_tag);
+    void StartExchange(const std::vector<double> &send, int destination,
+                       std::vector<double> *receive, int source, int tag);
+    void FinishExchange();
+   private:
+    MPI_Comm comm_;
+    int rank_ = 0, size_ = 1;
+    MPI_Request requests_[2];
+  };  // end of class MpiCommunicator
+#endif  // JADE_WITH_MPI
+  /// @brief MpiCommunicator for MPI_COMM_WORLD if MPI is initialized,
+  /// SerialCommunicator otherwise (or if built without JADE_WITH_MPI).
+  std::shared_ptr<Communicator> CreateDefaultCommunicator();
+  /// @brief True if the process was started by an MPI launcher
+  /// (mpirun, mpiexec or srun with PMI), so that MPI_Init() is worth
+  /// its cost.
+  bool IsMpiLaunch();
   // ********************************************************************** //
   // ********************************************************************** //
   // ********************************************************************** //
@@ -45,9 +386,27 @@ namespace jade {
   class SubPopulation {
    public:
     /// @brief Externaly defined fitness function, used by pointer.
-    double (*FitnessFunction)(std::vector<double> x) = nullptr;
+    double (*FitnessFunction)(const std::vector<double> &x) = nullptr;
+    /// @brief Externaly defined fitness function for a batch of
+    /// vectors, used by pointer. If set, it is used instead of
+    /// FitnessFunction, fitness should be resized to x.size().
+    void (*BatchFitnessFunction)(const std::vector<std::vector<double> > &x,
+                                 std::vector<double> &fitness) = nullptr;
+    /// @brief Externaly defined vector of objectives, used by pointer
+    /// in multi-objective mode (see SetObjectives()), objectives should
+    /// be resized to the number of objectives. Should be thread safe
+    /// for threads > 1.
+    void (*ObjectivesFunction)(const std::vector<double> &x,
+                               std::vector<double> &objectives) = nullptr;
     /// @brief Class initialization.
     int Init(long total_population, long dimension);              // NOLINT
+    /// @brief Ranks used for distribution, should be called before
+    /// Init(), otherwise CreateDefaultCommunicator() is used. All
+    /// SubPopulation objects sharing ranks of distribution level
+    /// should have the same communicator.
+    void SetCommunicator(std::shared_ptr<Communicator> communicator) {
+      communicator_ = communicator;
+    }
     /// @brief Vizualize used random distributions (to do manual check).
     void SetFeed(std::vector<std::vector<double> > x_feed_vectors);
     void CheckRandom();
@@ -63,7 +422,22 @@ namespace jade {
     int SetAdapitonFrequencyC(double c);
     /// @brief Set level of algorithm distribution.
     /// 0 - no distribution, each MPI process acts independantly.
+    /// 1 - single population shared by all MPI processes, each process
+    /// evaluates only its own slice of trial vectors.
+    /// 2 - island model, each MPI process evolves its own population
+    /// and periodically sends best individuals to neighbour process.
+    /// 3 - asynchronous steady-state model, process 0 keeps the single
+    /// population and sends trial vectors to any free process, each
+    /// result replaces its parent as soon as it arrives. Checkpoints
+    /// and population reduction are not used at this level.
     int SetDistributionLevel(int level);
+    /// @brief Set island model migration: number of generations
+    /// between migrations and number of migrating best individuals.
+    int SetMigration(long interval, long size);                        // NOLINT
+    /// @brief Select neighbour process to migrate to.
+    void SetMigrationTopologyRing() {isRandomTopology_ = false;}
+    void SetMigrationTopologyRandom() {isRandomTopology_ = true;}
+    void SwitchOffAdaptorsMigration() {isMigrateAdaptors_ = false;}
     /// @brief Set same search bounds for all components of fitness
     /// function input vector.
     int SetAllBounds(double lbound, double ubound);
@@ -78,37 +452,203 @@ namespace jade {
     std::vector<double> GetWorst(double *worst_fitness);
     int ErrorStatus() {return error_status_;};
     void SwitchOffPMCRADE(){isPMCRADE_ = false;};
+    /// @brief Do not print generation counter and final population.
+    void SwitchOffOutput() {isOutput_ = false;}
+    /// @brief Set seed of all random generators to make run
+    /// reproducible (should be called after Init). Each MPI process
+    /// uses its own stream, results do not depend on number of threads.
+    void SetSeed(unsigned long seed);                                  // NOLINT
+    /// @brief Write binary checkpoint every interval generations, each
+    /// MPI process writes its own file_name.<rank> file. Zero interval
+    /// switches checkpoints off, Init() keeps the setting.
+    int SetCheckpoint(std::string file_name, long interval);          // NOLINT
+    /// @brief Load checkpoint written by current process, next
+    /// RunOptimization() continues from saved generation. Should be
+    /// called after Init() with the same population and dimension.
+    /// Asynchronous distribution level 3 neither writes nor restores
+    /// checkpoints, so kError is returned for it.
+    int RestoreCheckpoint(std::string file_name);
+    /// @brief Set number of threads used by each MPI process to
+    /// evaluate fitness function. FitnessFunction or
+    /// BatchFitnessFunction should be thread safe for threads > 1.
+    int SetNumberOfThreads(int threads);
+    /// @brief Skip evaluation of vectors differing from already
+    /// evaluated ones less than resolution, capacity is the maximum
+    /// number of stored fitness values (zero switches cache off). If
+    /// isShared, all MPI processes exchange evaluated values every
+    /// generation. Should be called after Init().
+    int SetFitnessCache(long capacity, double resolution, bool isShared); // NOLINT
+    long GetFitnessCacheHits() const {                                 // NOLINT
+      return fitness_cache_ ? fitness_cache_->Hits() : 0;
+    }
+    long GetFitnessCacheMisses() const {                               // NOLINT
+      return fitness_cache_ ? fitness_cache_->Misses() : 0;
+    }
+    /// @brief Stop optimization before total generations max if best
+    /// fitness has changed less than tolerance during given number of
+    /// generations.
+    int SetStagnationStop(double tolerance, long generations);         // NOLINT
+    /// @brief Stop if the population bounding box is smaller than
+    /// tolerance in all dimensions.
+    int SetDiameterStop(double tolerance);
+    /// @brief Stop if RunOptimization() has taken more than seconds of
+    /// wall clock time or current process has evaluated fitness
+    /// function more than evaluations times (zero switches limit off).
+    int SetBudgetStop(double seconds, long evaluations);               // NOLINT
+    /// @brief Linear population size reduction (L-SHADE) from
+    /// total_population to minimum at total generations max, the worst
+    /// individuals are removed and archive is shrinked to population
+    /// size (zero switches reduction off).
+    int SetPopulationReduction(long minimum);                          // NOLINT
+    /// @brief Restart optimization at most restarts times if it has
+    /// converged (stagnation or diameter stop) before total
+    /// generations max. Each restart multiplies population size by
+    /// population_factor (IPOP, 1.0 keeps it) and starts from new
+    /// random vectors, as random generators continue their sequences,
+    /// fed with the elites best vectors found in all previous runs
+    /// (at distribution level 2 by all islands). Restarts share total
+    /// generations max and budget stop, checkpoints are written by
+    /// the first run only, population keeps the size of the last
+    /// restart. Used at distribution levels 0, 1 and 2 with single
+    /// objective (zero restarts switch it off).
+    int SetRestarts(long restarts, double population_factor,          // NOLINT
+                    long elites);                                      // NOLINT
+    /// @brief Restarts done by the last RunOptimization().
+    long GetRestarts() const {return restart_;}                        // NOLINT
+    /// @brief Elite set of the last RunOptimization() with restarts,
+    /// from the best vector.
+    std::vector<std::vector<double> > GetElites(std::vector<double> *fitness);
+    /// @brief Pre-screen trial vectors with a local radial basis
+    /// function model fitted to neighbours nearest individuals of
+    /// current population. Only evaluated_share of trials with the
+    /// best predicted gain over their parents are evaluated, the
+    /// others are not selected. The model switches itself off if
+    /// moving average of its absolute error for evaluated trials
+    /// divided by the error of using parent fitness as a prediction
+    /// exceeds max_error. Not used in asynchronous model (share 1
+    /// switches it off).
+    int SetSurrogate(double evaluated_share, long neighbours,         // NOLINT
+                     double max_error);
+    bool IsSurrogateOn() const {return isSurrogate_;}
+    /// @brief Refine the best individual with bounded quasi-Newton
+    /// method (BFGS projected to search bounds), gradient is found
+    /// with central finite differences. Gradient and line search
+    /// points of each iteration are evaluated as two batches, shared
+    /// by all MPI processes at distribution levels 1 and 3. Stops
+    /// after max_evaluations points, if relative change of fitness is
+    /// below tolerance or no better point is found. Should be called
+    /// after RunOptimization(), best individual is replaced if improved.
+    int PolishBest(long max_evaluations, double tolerance);            // NOLINT
+    /// @brief Points evaluated by the last PolishBest().
+    long GetPolishEvaluations() const {return polish_evaluations_;}    // NOLINT
+    /// @brief Search Pareto front of number objectives given by
+    /// ObjectivesFunction instead of optimum of fitness function (zero
+    /// switches multi-objective mode off). All objectives follow
+    /// optimization target. Parents and trial vectors are merged and
+    /// the best half of them is selected with non-dominated sorting
+    /// and crowding distance (NSGA-II), JADE adaptors are tuned with
+    /// parameters of selected trial vectors. Fitness of an individual
+    /// is its rank, best individual is a front member from the least
+    /// crowded region. Used at distribution levels 0 and 1 only,
+    /// fitness cache, surrogate and stagnation stop are not used,
+    /// restored population is evaluated again.
+    int SetObjectives(long number);                                   // NOLINT
+    /// @brief Non-dominated individuals of current population with
+    /// their objectives, ordered by the first objective.
+    std::vector<std::vector<double> > GetParetoFront(
+        std::vector<std::vector<double> > *objectives);
+    /// @brief Write per generation telemetry to file_name.<rank> as
+    /// JSON lines: time of evaluation, archive maintenance, MPI
+    /// communication and checkpoint phases, evaluation counters, best
+    /// fitness and adaptors (empty name switches it off). In
+    /// asynchronous model only process 0 writes it. Generation counts
+    /// from zero in each run started by SetRestarts(), records of a
+    /// run are marked with its restart index.
+    int SetTelemetry(std::string file_name);
+    /// @brief Append population to file_name.<rank> every interval
+    /// generations as rows of (generation, index, fitness, x) doubles,
+    /// gnuplot reads them with binary format='%<dimension + 3>double'.
+    /// Rows are written by a background thread, so optimizer does not
+    /// wait for disk (empty name switches it off). Shared population
+    /// of distribution level 1 is written by process 0 only, as well
+    /// as population of asynchronous master.
+    int SetPopulationDump(std::string file_name, long interval);      // NOLINT
+    /// @brief Should be called by fitness function for each failed
+    /// evaluation, is thread safe.
+    void CountFailedEvaluation() {++failed_evaluations_;}
+    /// @brief Generation reached by RunOptimization().
+    long GetCurrentGeneration() const {return current_generation_;}    // NOLINT
    private:
+    /// @brief Times separate algorithm steps of a prepared population.
+    friend class SubPopulationBenchmark;
     bool isPMCRADE_ = true;
+    bool isOutput_ = true;
     bool isFeed_ = false;
     int CreateInitialPopulation();
     int PrintPopulation();
     int PrintEvaluated();
-    int PrintSingleVector(std::vector<double> x);
+    int PrintSingleVector(const std::vector<double> &x);
+    /// @brief Indexes of all individuals sorted from the best one.
+    std::vector<long> GetSortedIndividuals();                          // NOLINT
+    /// @brief Sort individuals by fitness, only the best ones needed
+    /// for p-best selection and migration are ordered.
     int SortEvaluatedCurrent();
+    /// @brief Comparison of fitness values according to optimization target.
+    bool IsBetter(double a, double b) const {
+      return is_find_minimum_ ? a < b : a > b;
+    }
+    /// @brief Set range of individuals evaluated by current process.
+    int SetSliceIndexes();
+    /// @brief Share evaluated slices of population between all processes.
+    int ExchangeSlices(PopulationMatrix *x_vectors,
+                       std::vector<double> *evaluated_fitness);
+    int ExchangeNextGeneration();
     /// @brief Apply fitness function to current population.
     int EvaluateCurrentVectors();
-    /// @brief Generate crossover and mutation factors for current individual
-    int SetCRiFi(long i);
+    /// @brief Apply fitness function to a batch of vectors, values
+    /// found in fitness cache are not evaluated. Collective call if
+    /// cache is shared.
+    int EvaluateBatch(const std::vector<std::vector<double> > &x,
+                      std::vector<double> *fitness);
+    int EvaluateBatchUncached(const std::vector<std::vector<double> > &x,
+                              std::vector<double> *fitness);
+    /// @brief Generate crossover and mutation factors and random
+    /// values for crossover of all individuals evaluated by current
+    /// process in a single batch.
+    int SetCRiFi();
+    /// @brief Same for a single individual from already filled
+    /// random_batch_.
+    int SetCRiFi(long individual_index);                               // NOLINT
     /// @name Main algorithm steps.
     // @{
-    int Selection(std::vector<double> crossover_u,
-                  long individual_index);
+    int Selection(long individual_index);                              // NOLINT
     int ArchiveCleanUp();
+    /// @brief Remove random archived vectors to fit population size.
+    int TrimArchive();
     int Adaption();
-    std::vector<double> Mutation(long individual_index);
-    std::vector<double> Crossover(std::vector<double> mutated_v,
-                                  long individual_index);
+    /// @brief Remove the worst individuals to fit linear population
+    /// size reduction for current generation.
+    int ReducePopulation();
+    /// @brief Set number of used individuals, memory is allocated for
+    /// total_population_ of them in Init().
+    int SetPopulationSize(long size);                                  // NOLINT
+    /// @brief Hot path works with preallocated rows, so no memory
+    /// allocation is done per individual.
+    int Mutation(long individual_index, double *mutation_v);         // NOLINT
+    int Crossover(long individual_index, double *crossover_u);       // NOLINT
+    /// @brief Kernels for current dimension, selected in Init().
+    MutationKernelPointer mutation_kernel_ = &MutationKernel;
+    CrossoverKernelPointer crossover_kernel_ = &CrossoverKernel;
     // @}
     /// @name Other algorithm steps.
     // @{
-    std::vector<double> GetXpBestCurrent();
+    const double* GetXpBestCurrent();
     /// @brief Returns random vector from current population and
     /// vector`s index.
-    std::vector<double> GetXRandomCurrent(long *index,
-                                          long forbidden_index);
-    std::vector<double> GetXRandomArchiveAndCurrent(
-                   long forbidden_index1, long forbidden_index2);
+    const double* GetXRandomCurrent(long *index,                     // NOLINT
+                                    long forbidden_index);           // NOLINT
+    const double* GetXRandomArchiveAndCurrent(
+                   long forbidden_index1, long forbidden_index2);    // NOLINT
     // @}
     /// @name Population, individuals and algorithm .
     // @{
@@ -120,9 +660,14 @@ namespace jade {
     long total_population_ = 0;                                        // NOLINT
     /// @brief Number of individuals in subpopulation
     long subpopulation_ = 0;                                  // NOLINT
-    /* /// @brief All individuals are indexed. First and last index of */
-    /* /// individuals in subpopulations. */
-    /* long index_first_ = -1, index_last_ = -1;                          // NOLINT */
+    /// @brief Final population size for linear population size
+    /// reduction, zero if reduction is switched off.
+    long population_minimum_ = 0;                                      // NOLINT
+    /// @brief All individuals are indexed. First and last (not
+    /// included) index of individuals evaluated by current process.
+    long index_first_ = -1, index_last_ = -1;                          // NOLINT
+    /// @brief Max number of individuals evaluated by single process.
+    long slice_size_ = 0;                                              // NOLINT
     /// @brief Dimension of the optimization task (number of variables
     /// to optimize).
     long dimension_ = -1;                                              // NOLINT
@@ -131,24 +676,24 @@ namespace jade {
     /// @brief Several feed vectors.
     std::vector<std::vector<double> > x_feed_vectors_;
     /// @brief Current state vectors of all individuals in subpopulation.
-    std::vector<std::vector<double> > x_vectors_current_;
+    PopulationMatrix x_vectors_current_;
     /// @brief State vectors of all individuals in subpopulation in
     /// new generation.
-    std::vector<std::vector<double> > x_vectors_next_generation_;
-    /// @brief Sometimes sorted list of evaluated fitness function.
-    std::list<std::pair<double, long> >                                // NOLINT
-        evaluated_fitness_for_current_vectors_;
-    /// @brief Sometimes sorted list of evaluated fitness function for
-    /// next generation.
-    std::list<std::pair<double, long> >                                // NOLINT
-        evaluated_fitness_for_next_generation_;
-    /// @brief Archived best solutions (state vactors)
-    std::list<std::vector<double> > archived_best_A_;
-    std::list<std::vector<double> > to_be_archived_best_A_;
-    /// @brief Sometimes sorted list of evaluated fitness function for
-    /// best vectors.
-    std::list<std::pair<double, long> >                                // NOLINT
-        evaluated_fitness_for_archived_best_;
+    PopulationMatrix x_vectors_next_generation_;
+    /// @brief Evaluated fitness function for each individual.
+    std::vector<double> evaluated_fitness_for_current_vectors_;
+    /// @brief Evaluated fitness function for each individual in next
+    /// generation.
+    std::vector<double> evaluated_fitness_for_next_generation_;
+    /// @brief Indexes of individuals in current population, first
+    /// sorted_individuals_size_ of them are sorted from the best one.
+    std::vector<long> sorted_individuals_;                             // NOLINT
+    long sorted_individuals_size_ = 0;                                 // NOLINT
+    /// @brief Archived best solutions (state vactors), stored one by
+    /// one in a flat buffer.
+    PopulationMatrix archived_best_A_;
+    long archive_size_ = 0;                                            // NOLINT
+    double* GetArchived(long n) {return archived_best_A_[n];}         // NOLINT
     /// @brief Low and upper bounds for x vectors.
     std::vector<double> x_lbound_;
     std::vector<double> x_ubound_;
@@ -158,6 +703,16 @@ namespace jade {
     double adaptor_crossover_mu_CR_ = 0.5;
     /// @brief Individual mutation and crossover parameters for each individual.
     std::vector<double> mutation_F_, crossover_CR_;
+    /// @brief Uniform random values for current generation, for each
+    /// individual: F_i, two for CR_i, j_rand and D values for crossover.
+    std::vector<double> random_batch_;
+    static const long kRandomBatchHeader = 4;                          // NOLINT
+    /// @brief Trial vectors of current generation for individuals
+    /// evaluated by current process and their fitness.
+    std::vector<std::vector<double> > trial_vectors_u_;
+    std::vector<double> evaluated_fitness_for_trial_vectors_;
+    /// @brief Selection result for each individual in current generation.
+    std::vector<long> is_selection_success_;                           // NOLINT
     std::list<double> successful_mutation_parameters_S_F_;
     std::list<double> successful_crossover_parameters_S_CR_;
     /// @brief Share of all individuals in current population to be
@@ -179,6 +734,8 @@ namespace jade {
     /// @todo Select random generator enginge for best results in DE!
     std::mt19937_64 generator_;
     //std::ranlux48 generator_;
+    /// @brief Generator for per-generation batch of random values.
+    CounterRandom random_batch_generator_;
     /// @brief randn(&mu;, &sigma^2; ) denotes a random value from a normal
     /// distribution of mean &mu; and variance &sigma^2;
     double randn(double mean, double stddev);
@@ -192,13 +749,244 @@ namespace jade {
     // @}
     /// @name MPI section
     // @{
+    /// @brief Ranks are MPI processes or threads, depending on
+    /// communicator backend.
+    std::shared_ptr<Communicator> communicator_;
     int process_rank_;
     int number_of_processes_;
     int AllGatherVectorDouble(std::vector<double> to_send);
     std::vector<double> recieve_double_;
     int AllGatherVectorLong(std::vector<long> to_send);
+    /// @brief Same as AllGatherVectorDouble(), but size of to_send
+    /// may differ between processes.
+    int AllGatherVariableVectorDouble(const std::vector<double> &to_send);
     std::vector<long> recieve_long_;
-       
+    long BroadcastLong(long value);                                    // NOLINT
+    // @}
+    /// @brief Threads used to evaluate fitness function.
+    std::unique_ptr<ThreadPool> thread_pool_;
+    /// @name Fitness cache section
+    // @{
+    /// @brief Send values evaluated by current process to all other
+    /// processes and add received ones to cache.
+    int ShareFitnessCache();
+    std::unique_ptr<FitnessCache> fitness_cache_;
+    bool isCacheShared_ = false;
+    /// @brief Vectors missed in cache in current batch and their place
+    /// in the batch.
+    std::vector<std::vector<double> > cache_missed_x_;
+    std::vector<double> cache_missed_fitness_;
+    std::vector<long> cache_missed_index_;                             // NOLINT
+    std::vector<double> cache_send_;
+    // @}
+    /// @name Stopping criteria section
+    // @{
+    /// @brief Decision is agreed by all processes, they stop if all
+    /// of them have converged or any of them has exhausted its budget.
+    bool IsStopCriterion();
+    /// @brief Largest size of the population bounding box.
+    double GetPopulationDiameter();
+    double stagnation_tolerance_ = 0.0;
+    long stagnation_generations_ = 0;                                  // NOLINT
+    /// @brief Best fitness of last stagnation_generations_ + 1
+    /// generations in a circular buffer.
+    std::vector<double> best_fitness_history_;
+    long best_fitness_history_size_ = 0;                               // NOLINT
+    double diameter_tolerance_ = 0.0;
+    double budget_seconds_ = 0.0;
+    long budget_evaluations_ = 0;                                      // NOLINT
+    double start_time_ = 0.0;
+    /// @brief Fitness function calls done by current process.
+    long evaluations_ = 0;                                             // NOLINT
+    // @}
+    /// @name Surrogate section
+    // @{
+    /// @brief Evaluate trial vectors of current generation, only the
+    /// most promising ones if surrogate is on.
+    int ScreenTrials();
+    /// @brief Fitness of x predicted from surrogate_neighbours_
+    /// individuals of current population nearest to it.
+    double PredictFitness(const double *x);
+    /// @brief Squared distance with coordinates scaled by search
+    /// bounds, so all dimensions have the same weight.
+    double GetScaledDistance(const double *a, const double *b) const;
+    /// @brief Compare predicted and real fitness of evaluated trials.
+    int UpdateSurrogateError();
+    bool isSurrogate_ = false;
+    double surrogate_share_ = 1.0;
+    long surrogate_neighbours_ = 0;                                    // NOLINT
+    double surrogate_max_error_ = 1.0;
+    double surrogate_error_ = 0.0;
+    long surrogate_generations_ = 0;                                   // NOLINT
+    /// @brief Trials skipped in current generation.
+    std::vector<char> is_trial_screened_;
+    long screened_trials_ = 0;                                         // NOLINT
+    /// @brief Predicted gain of each trial over its parent, trials
+    /// ordered from the most promising one.
+    std::vector<double> surrogate_gain_;
+    std::vector<long> surrogate_order_;                                // NOLINT
+    /// @brief Distances between all individuals of current population.
+    std::vector<double> surrogate_pair_distance_;
+    /// @brief Buffers of PredictFitness().
+    std::vector<double> surrogate_distance_, surrogate_gram_,
+      surrogate_weights_;
+    std::vector<long> surrogate_index_;                                // NOLINT
+    /// @brief Evaluated trials and their fitness.
+    std::vector<std::vector<double> > surrogate_x_;
+    std::vector<double> surrogate_fitness_;
+    // @}
+    /// @name Multi-objective section
+    // @{
+    /// @brief Evaluate objectives of trial_vectors_u_ and store them
+    /// with the vectors in slice rows of x_vectors and objectives,
+    /// slices are shared between processes.
+    int EvaluateParetoSlice(PopulationMatrix *x_vectors,
+                            std::vector<double> *objectives);
+    int EvaluateObjectives(const std::vector<std::vector<double> > &x,
+                           std::vector<double> *objectives);
+    /// @brief Same as ExchangeSlices(), objectives are sent instead of
+    /// fitness.
+    int ExchangeObjectives(PopulationMatrix *x_vectors,
+                           std::vector<double> *objectives);
+    /// @brief Select next generation from parents and all trial vectors.
+    int SelectPareto();
+    /// @brief Returns 1 if objectives a dominate b, -1 if b dominate
+    /// a and 0 otherwise.
+    int GetDominance(const double *a, const double *b) const;
+    /// @brief Non-dominated rank (zero for the front) and crowding
+    /// distance of size individuals with objectives stored one by one.
+    int SortFronts(const std::vector<double> &objectives, long size, // NOLINT
+                   std::vector<long> *rank, std::vector<double> *crowding); // NOLINT
+    /// @brief Fitness rank + 1/(2 + crowding) with the sign of
+    /// optimization target, so IsBetter() and sorting are unchanged.
+    int SetParetoScore(const std::vector<double> &objectives,
+                       std::vector<double> *fitness);
+    long objectives_number_ = 0;                                       // NOLINT
+    /// @brief Objectives of individuals stored one by one.
+    std::vector<double> objectives_current_, objectives_next_generation_;
+    /// @brief All trial vectors of current generation and their
+    /// objectives.
+    PopulationMatrix pareto_trials_;
+    std::vector<double> pareto_trial_objectives_;
+    /// @brief Buffers of selection and sorting.
+    std::vector<double> pareto_slice_objectives_, pareto_union_objectives_;
+    std::vector<long> pareto_rank_, pareto_order_, pareto_index_;     // NOLINT
+    std::vector<long> pareto_dominated_count_;                        // NOLINT
+    std::vector<std::vector<long> > pareto_dominated_;                // NOLINT
+    std::vector<double> pareto_crowding_;
+    // @}
+    /// @name Restart section
+    // @{
+    /// @brief Single run from Init() (or restored checkpoint) to a
+    /// stop criterion.
+    int RunSingleOptimization();
+    /// @brief Merge best individuals of current population into elite
+    /// set, identical vectors are kept once.
+    int UpdateElites();
+    /// @brief Resize population buffers for the next restart.
+    int ResizePopulation(long size);                                   // NOLINT
+    long restarts_max_ = 0, elites_max_ = 0, restart_ = 0;             // NOLINT
+    double restart_population_factor_ = 1.0;
+    /// @brief Last stop was agreed convergence of all processes, not
+    /// exhausted budget.
+    bool isConverged_ = false;
+    std::vector<std::pair<double, std::vector<double> > > elites_;
+    /// @brief Marks individuals fed from elite set (and their
+    /// successors) in restarted population, stagnation stop uses the
+    /// other ones, as elites would keep the best fitness fixed.
+    std::vector<char> isFedElite_;
+    // @}
+    /// @name Polishing section
+    // @{
+    /// @brief Fitness with sign making it minimized. Points are split
+    /// between MPI processes if all of them have the same population.
+    int EvaluatePolishBatch(const std::vector<std::vector<double> > &x,
+                            std::vector<double> *fitness);
+    /// @brief Central differences, one-sided at search bounds.
+    int GetPolishGradient(const std::vector<double> &x,
+                          std::vector<double> *gradient);
+    /// @brief Finite difference step relative to search range, cube
+    /// root of machine epsilon balances truncation and rounding errors
+    /// of central differences.
+    static constexpr double kPolishStep = 6e-6;
+    long polish_evaluations_ = 0;                                      // NOLINT
+    /// @brief Buffers of polishing batches.
+    std::vector<std::vector<double> > polish_x_, polish_local_x_;
+    std::vector<double> polish_fitness_, polish_local_fitness_;
+    // @}
+    /// @name Island model section
+    // @{
+    /// @brief Post non-blocking send of best individuals to neighbour
+    /// process and receive of its best ones.
+    int StartMigration();
+    /// @brief Wait for migration to complete and replace worst
+    /// individuals with immigrants.
+    int FinishMigration();
+    long migration_interval_ = 50;                                     // NOLINT
+    long migration_size_ = 5;                                          // NOLINT
+    bool isRandomTopology_ = false;
+    bool isMigrateAdaptors_ = true;
+    bool isMigrationPending_ = false;
+    /// @brief Same on all processes, used to select random topology.
+    std::mt19937_64 migration_generator_;
+    std::vector<double> migration_send_, migration_recieve_;
+    // @}
+    /// @name Asynchronous model section
+    // @{
+    int RunAsynchronous();
+    /// @brief Process 0 evolves population, other processes evaluate
+    /// trial vectors. A generation is accounted for each
+    /// subpopulation_ evaluated trial vectors.
+    int RunMaster();
+    int RunWorker();
+    /// @brief Append trial vectors for non-pending individuals to
+    /// message as (index, vector) records, returns number of them.
+    long MakeTrials(std::vector<double> *message);                     // NOLINT
+    /// @brief Evaluate message of (index, vector) records into
+    /// (index, fitness) pairs.
+    int EvaluateTrials(const std::vector<double> &message,
+                       std::vector<double> *result);
+    /// @brief Steady-state selection for (index, fitness) pairs.
+    int AcceptTrials(const std::vector<double> &result);
+    int BroadcastPopulation();
+    /// @brief Individuals with trial vector being evaluated.
+    std::vector<char> is_trial_pending_;
+    long trials_to_send_ = 0, trials_received_ = 0;                    // NOLINT
+    long next_target_ = 0;                                             // NOLINT
+    /// @brief Buffers of EvaluateTrials().
+    std::vector<std::vector<double> > trial_batch_x_;
+    std::vector<double> trial_batch_fitness_;
+    // @}
+    /// @name Telemetry section
+    // @{
+    enum Phase {kEvaluate = 0, kArchive, kCommunicate, kCheckpoint, kPhases};
+    int StartTelemetry();
+    int StartGenerationTelemetry();
+    int WriteTelemetry();
+    int StopTelemetry();
+    /// @brief Time spent in each phase during current generation.
+    double phase_time_[kPhases] = {0.0, 0.0, 0.0, 0.0};
+    double generation_start_time_ = 0.0;
+    long generation_start_evaluations_ = 0;                            // NOLINT
+    long generation_start_failed_ = 0;                                 // NOLINT
+    long generation_start_hits_ = 0;                                   // NOLINT
+    std::atomic<long> failed_evaluations_{0};                          // NOLINT
+    std::string telemetry_name_;
+    FILE *telemetry_file_ = nullptr;
+    /// @brief Population dump shares telemetry hooks.
+    int WritePopulationDump();
+    std::string dump_name_;
+    long dump_interval_ = 0;                                           // NOLINT
+    std::unique_ptr<stream_writer::StreamWriter> dump_writer_;
+    // @}
+    /// @name Checkpoint section
+    // @{
+    int WriteCheckpoint();
+    /// @brief Each process uses its own file_name.<rank> file.
+    std::string GetProcessFileName(std::string file_name);
+    std::string checkpoint_name_;
+    long checkpoint_interval_ = 0;                                     // NOLINT
+    bool isRestored_ = false;
     // @}
     /// @brief Subpopulation status. If non-zero than some error has appeared.
     int error_status_ = 0;
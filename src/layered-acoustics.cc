@@ -31,34 +31,118 @@
 /// @brief Simulate scattering from PEC sphere covered with dielectric
 /// multilayered shell
 /// 
+#ifdef JADE_WITH_MPI
 #include <mpi.h>
+#endif
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <cctype>
 #include <cstdio>
 #include <complex>
 #include "./jade.h"
 #include <cstdlib>
 #include <cstdio>
 #include <ctime>
+#include <random>
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include "./gnuplot-wrapper/gnuplot-wrapper.h"
 #include "./nmie/nmie-applied.h"
-//#include "./read-spectra/read-spectra.h"
+#include "./material/material.h"
+#include "./mie-batch/mie-batch.h"
 const double pi=3.14159265358979323846;
 const double speed_of_light = 299792458;
 template<class T> inline T pow2(const T value) {return value*value;}
 void SetOptimizer();
-void SetMie();
-void SetGeometry();
+void SetGeometry(std::vector<double> *input);
+void RunSpectrum(const std::vector<double> &input);
+void RunFitnessBenchmark();
+double PointFitness(double Qsca, double Qabs, double r_outer);
+double BandFitness(const std::vector<double> &Qsca,
+                   const std::vector<double> &Qabs, double r_outer);
+double BandAverage(const std::vector<double> &values);
+std::vector<double> WriteParetoFront(double *fitness);
+double OptimizeInput();
+void RunFarm();
+void FinalizeMpi();
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Mie problem with fixed layers and materials, prepared once. For
+// each evaluation only widths and wavelength are updated, target
+// and Mie coefficients buffers keep their memory between
+// calls. Each thread should use its own object.
+class PreparedMie {
+ public:
+  // Radii in units of lambda_0_ and frequency in units of omega_0_,
+  // order of radii is fixed with SetGeometry().
+  void SetInput(const std::vector<double> &input);
+  const std::vector<double>& GetInput() const {return input_;}
+  // Number of multipole terms is chosen from size parameter, so that
+  // neglected terms are below terms_tolerance (zero uses nmie
+  // default). Closed form quasi-static solution is used instead of
+  // Mie series if its error estimate is below quasi_static_tolerance
+  // (zero switches it off).
+  void SetTolerance(double terms_tolerance, double quasi_static_tolerance);
+  void RunMieCalculation();
+  double GetQsca() {return isQuasiStatic_ ? Qsca_ : mie_.GetQsca();}
+  double GetQabs() {return isQuasiStatic_ ? Qabs_ : mie_.GetQabs();}
+  // Dipole efficiencies of layered sphere in electrostatic limit for
+  // the current target, returns estimate (|m| x)^2 of their relative
+  // error, m is the largest layer index and x is size parameter.
+  double GetQuasiStatic(double *Qsca, double *Qabs) const;
+  // Evaluate all band frequencies (in units of omega_0_) for the
+  // geometry from the last SetInput(). Radii and dispersive indexes
+  // for the band are computed once and reused.
+  void RunBand(const std::vector<double> &band,
+               std::vector<double> *Qsca, std::vector<double> *Qabs);
+  // Append mie_batch targets for all band frequencies (or for the
+  // frequency of the last SetInput() if band is empty), quasi-static
+  // tolerance is not used.
+  void AddBatchTargets(const std::vector<double> &band,
+                       std::vector<mie_batch::Target> *targets);
+ private:
+  void SetBand(const std::vector<double> &band);
+  void SetTarget(double omega, std::complex<double> metal_index);
+  // Size parameter of the current target multiplied by the largest
+  // layer index.
+  double GetIndexSizeParameter() const;
+  int GetMaxTerms() const;
+  nmie::MultiLayerMieApplied mie_;
+  double terms_tolerance_ = 0.0, quasi_static_tolerance_ = 0.0;
+  bool isQuasiStatic_ = false;
+  double Qsca_ = 0.0, Qabs_ = 0.0;
+  // Target of the last SetTarget().
+  double wavelength_ = 0.0;
+  std::complex<double> target_metal_index_;
+  std::vector<double> input_;
+  double r1_ = 0.0, r2_ = 0.0, r3_ = 0.0;
+  // Dispersive index of the middle layer is updated only if
+  // frequency or materials_version_ changes.
+  long materials_version_ = -1;
+  double omega_ = -1.0;
+  std::complex<double> metal_index_;
+  std::vector<double> band_;
+  std::vector< std::complex<double> > band_metal_index_;
+};
 
-double EvaluateFitness(std::vector<double> input);
+double EvaluateFitness(const std::vector<double> &x);
+void EvaluateFitnessBatch(const std::vector< std::vector<double> > &x,
+                          std::vector<double> &fitness);
+void EvaluateObjectives(const std::vector<double> &x,
+                        std::vector<double> &objectives);
 jade::SubPopulation sub_population_;  // Optimizer of parameters for Mie model.
+// MPI is initialized only if the driver was started by an MPI launcher
+// (and built with JADE_WITH_MPI), otherwise optimizer and spectrum run
+// in a single process with threads_per_process_ threads, so single
+// runs and sweeps need neither mpirun nor MPI startup.
+bool isMpi_ = false;
+std::shared_ptr<jade::Communicator> communicator_;
 // ********************************************************************** //
 // ********************************************************************** //
 // ********************************************************************** //
-nmie::MultiLayerMieApplied multi_layer_mie_;  
 double l2w( double l) {return 2.0 * pi * speed_of_light/l;};  // lambda to omega
 double w2l( double w) {return 2.0 * pi * speed_of_light/w;};
 // ********************************************************************** //
@@ -79,13 +163,6 @@ int dim_=3;
 std::vector<double> input_ = {0.00635, 0.00747, 0.00747000001, 1.0};
 //0.142135
 //std::vector<double> input_ = {6.3535e-3, 7.4765e-3, 7.4766e-3, 1};
-double r1_ = input_[0]*lambda_0_;
-double r2_ = input_[1]*lambda_0_;
-double r3_ = input_[2]*lambda_0_;
-double omega_ = input_[3]*omega_0_;
-double core_width_ = r1_;
-double inshell_width_ = r2_ - r1_;
-double outshell_width_ = r3_ - r2_;
 double from_omega_ = 0.1*omega_0_;
 double to_omega_ = 2.0*omega_0_;
 std::complex<double> inshell_index_(0,0);
@@ -99,10 +176,16 @@ std::complex<double> outshell_index_ = std::sqrt(std::complex<double>(8.4,2.33))
 const double gamma_d_ = 2.0*pi*17.64*1.0e12;
 const double omega_p_ = 2.0*pi*2069.0*1.0e12;
 
-std::complex<double> epsilon_m(double omega) {
-  //return 1.53 - pow2(omega_p_)/(omega*(omega +std::complex<double>(0,1)*gamma_d_));
-  return -10.37+ 0.35*std::complex<double>(0,1);
-}
+// Material of the middle layer. Drude model would be
+//   material::DrudeMaterial metal_(1.53, omega_p_, gamma_d_);
+// and experimental data is read once with TabulatedMaterial::Read().
+material::ConstantMaterial metal_(std::complex<double>(-10.37, 0.35));
+// Index of metal_ precomputed on spectrum frequencies in main(), all
+// evaluations take it from the table.
+material::IndexTable metal_index_table_;
+// Is incremented when layer materials change, so that prepared Mie
+// problems drop their cached indexes.
+long materials_version_ = 0;
 // Set dispersion
 double from_wl_ = w2l(from_omega_);
 double to_wl_ = w2l(to_omega_);
@@ -110,72 +193,670 @@ int samples_ = 1300;
 double plot_from_wl_ = from_wl_, plot_to_wl_ = to_wl_;
 int plot_samples_ = samples_;
 double plot_xshare_ = 0.1;
+// Spectrum of the final design is evaluated at samples_ frequencies
+// and written either to gnuplot files or to spectrum_name_.bin with
+// rows of (omega/omega_0, Qsca, Qabs) doubles, to plot it use
+//   plot 'file.bin' binary format='%3double' using 1:2
+bool isSpectrum_ = false;
+bool isSpectrumBinary_ = false;
+std::string spectrum_name_ = "layered-acoustics-spectrum";
+const int kSpectrumColumns = 3;
+// Frequencies of broadband objective in units of omega_0_ (should be
+// ascending), if empty fitness is evaluated at input_[3] only. Band
+// fitness is the mean (trapezoidal rule) of single frequency fitness
+// or its worst value.
+std::vector<double> band_omega_ = {};
+bool isBandWorstCase_ = false;
+// Instead of the blend of PointFitness() optimizer finds the Pareto
+// front of Qabs and Zeta (both maximized, band averages for broadband
+// objective), it is printed and written to pareto_name_ gnuplot
+// files. Design reported in the end is the front member with the best
+// PointFitness() of its objectives.
+bool isParetoFront_ = false;
+std::string pareto_name_ = "layered-acoustics-pareto";
+// Instead of optimization time fitness_benchmark_calls_ calls of
+// EvaluateFitness() for random radii inside optimizer bounds.
+bool isFitnessBenchmark_ = false;
+long fitness_benchmark_calls_ = 10000;
+// Instead of a single run optimize all jobs listed in farm_jobs_name_,
+// one job per line of whitespace separated key=value pairs, e.g.
+//   name=thin-shell lower=1e-11 upper=0.5 lambda=500 core=1.29,0.01
+//   metal=-10.37,0.35 outshell=8.4,2.33 population=750 generations=1500
+// Permittivities are (re,im) pairs, lambda is the wavelength of point
+// objective in nm, band=0.9,1.0,1.1 (in units of omega_0_) switches
+// to broadband objective, worst=1 to its worst case and pareto=1 to
+// the Pareto front. Keys not given keep the values of the globals in
+// this file, lines starting with '#' are comments. With MPI process
+// 0 deals jobs to groups of processes_per_job_ processes as soon as
+// they are free and appends a line for each finished job (name,
+// fitness, Qabs, Qsca, radii, seconds) to farm_name_; without MPI jobs
+// run one by one. Checkpoints are kept per job, so restart of the
+// farm skips the finished generations, telemetry and population dump
+// names get job name prefix.
+std::string farm_jobs_name_ = "";
+std::string farm_name_ = "layered-acoustics-farm.txt";
+int processes_per_job_ = 1;
 // Set optimizer
 int total_generations_ = 1500;
 int population_multiplicator_ = 250;
+// If positive, overrides dim_*population_multiplicator_.
+long population_size_ = 0;
+// Final size of linearly reduced population, zero to keep it fixed.
+long population_minimum_ = 0;
+// Per generation timings and counters are written to
+// telemetry_name_.<rank> as JSON lines, empty name switches it off.
+std::string telemetry_name_ = "";
+// Population is appended to population_dump_name_.<rank> every
+// population_dump_interval_ generations as binary rows of (generation,
+// index, fitness, radii) doubles, to plot fitness history use
+//   plot 'file.0' binary format='%6double' using 1:3
+std::string population_dump_name_ = "";
+long population_dump_interval_ = 1;
+// 1 - each MPI process evaluates a slice of shared population, 3 -
+// asynchronous mode, process 0 sends trial vectors to free processes,
+// better for processes of different speed.
+int distribution_level_ = 1;
+// Threads used by each MPI process to evaluate population.
+int threads_per_process_ = 1;
+// Periodic checkpoint, restart resumes from it if found.
+std::string checkpoint_name_ = "layered-acoustics-checkpoint";
+long checkpoint_interval_ = 100;
+// Number of stored fitness values, vectors closer than eps_ are
+// evaluated only once.
+long fitness_cache_size_ = 1 << 16;
+// Optimization stops if the best fitness has changed less than
+// tolerance during given number of generations.
+double stagnation_tolerance_ = 1e-12;
+long stagnation_generations_ = 300;
+// Stagnated optimization is restarted at most restarts_ times within
+// total_generations_, population grows restart_population_factor_
+// times (IPOP) and is fed with restart_elites_ best designs found so
+// far.
+long restarts_ = 0;
+double restart_population_factor_ = 2.0;
+long restart_elites_ = 5;
+// If positive, the best design is refined with quasi-Newton method
+// using at most polish_evaluations_ fitness evaluations, until
+// relative change of fitness is below polish_tolerance_. Last digits
+// are found much faster than by DE, so stagnation stop above may be
+// looser.
+long polish_evaluations_ = 0;
+double polish_tolerance_ = 1e-15;
+// Share of trial vectors evaluated after pre-screening with surrogate
+// model fitted to surrogate_neighbours_ nearest individuals, 1.0
+// switches it off. Surrogate switches itself off if it predicts worse
+// than parent fitness.
+double surrogate_share_ = 1.0;
+long surrogate_neighbours_ = 20;
+// Multipole terms are truncated when the next one is estimated to be
+// below mie_tolerance_ (zero uses nmie default).
+double mie_tolerance_ = 1e-10;
+// Evaluations with quasi-static error estimate below the tolerance
+// use the closed form solution (zero switches it off).
+double quasi_static_tolerance_ = 0.0;
+// Population and spectrum are evaluated as a single mie_batch batch,
+// on CUDA or HIP device if mie-batch is built with device support (on
+// host in one thread otherwise). Quasi-static model and Pareto front
+// evaluate each vector with nmie.
+bool isMieBatch_ = false;
+// If positive, optimization first runs these generations with
+// quasi-static model for any size, the best design is fed to the
+// optimization with full Mie model.
+long quasi_static_generations_ = 0;
+bool isQuasiStaticStage_ = false;
 double Qsca_best_ = 0.0;
 double Qabs_best_ = 0.0;
 // ********************************************************************** //
 // ********************************************************************** //
 // ********************************************************************** //
 const double eps_=1e-11;
+// Optimizer bounds of all radii in units of lambda_0_.
+double lower_bound_ = eps_, upper_bound_ = 2.0-eps_;
 int main(int argc, char *argv[]) {
-  MPI_Init(&argc, &argv);
-  int rank;
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#ifdef JADE_WITH_MPI
+  isMpi_ = jade::IsMpiLaunch();
+  if (isMpi_) MPI_Init(&argc, &argv);
+#endif
+  communicator_ = jade::CreateDefaultCommunicator();
+  int rank = communicator_->Rank();
   try {
     std::vector< std::vector<double> > spectra;
     if (from_omega_ > to_omega_) throw std::invalid_argument("Wrong omega range!");
+    metal_index_table_.Init(metal_, from_omega_, to_omega_, samples_);
+    if (!std::is_sorted(band_omega_.begin(), band_omega_.end()))
+      throw std::invalid_argument("Wrong objective band!");
     
-    if (!isPreset) {
-      SetOptimizer();
-      // std::vector<double> feed = {input_[0],input_[1]};
-      // sub_population_.SetFeed({feed});
-      sub_population_.RunOptimization();
-      auto best_x  = sub_population_.GetBest(&Qsca_best_);
-      for (int i = 0; i< best_x.size(); ++i)
-	input_[i] = best_x[i];
+    if (isFitnessBenchmark_) {
+      RunFitnessBenchmark();
+      FinalizeMpi();
+      return 0;
+    }
+    if (!farm_jobs_name_.empty()) {
+      RunFarm();
+      FinalizeMpi();
+      return 0;
     }
+    if (!isPreset) OptimizeInput();
     
-    SetGeometry();    SetMie();
+    SetGeometry(&input_);
+    PreparedMie mie;
+    mie.SetTolerance(mie_tolerance_, 0.0);
+    mie.SetInput(input_);
     if (rank ==0) {printf("Input_:"); for (auto value : input_) printf(" %24.22f,", value);  }
-    multi_layer_mie_.RunMieCalculation();
-    Qsca_best_ = multi_layer_mie_.GetQsca();
-    Qabs_best_ = multi_layer_mie_.GetQabs();
+    mie.RunMieCalculation();
+    Qsca_best_ = mie.GetQsca();
+    Qabs_best_ = mie.GetQabs();
+    double Qsca_static, Qabs_static;
+    double static_error = mie.GetQuasiStatic(&Qsca_static, &Qabs_static);
     if (rank ==0) {
       printf("\nQabs: %24.22f\nQsca: %24.22f\nZeta=%24.22f\n",Qabs_best_,Qsca_best_, Qabs_best_/Qsca_best_);
-      double Cabs = Qabs_best_*pi*pow2(r3_);
+      printf("Quasi-static Qabs: %g Qsca: %g (error estimate %g)\n",
+             Qabs_static, Qsca_static, static_error);
+      double r3 = input_[2]*lambda_0_;
+      double Cabs = Qabs_best_*pi*pow2(r3);
       double A = 3.0*pow2(lambda_0_)/(8.0*pi);
       printf("Cabs = %g\nA = %g\n",Cabs,A);
     }
+    if (isSpectrum_) RunSpectrum(input_);
   } catch( const std::invalid_argument& ia ) {
     // Will catch if  multi_layer_mie_ fails or other errors.
     std::cerr << "Invalid argument: " << ia.what() << std::endl;
     //MPI_Abort(MPI_COMM_WORLD, 1);  
   }  
-  MPI_Finalize();
+  FinalizeMpi();
   return 0;
 }
 // ********************************************************************** //
 // ********************************************************************** //
 // ********************************************************************** //
-double EvaluateFitness(std::vector<double> input) {
-  // Copy releveant part of optimizer input to global var input_ for Mie calculations
-  for (int i = 0; i< input.size(); ++i)
-    input_[i] = input[i];
-  SetGeometry();
-  SetMie();
-  double Zeta = 0.0;
+void FinalizeMpi() {
+#ifdef JADE_WITH_MPI
+  if (isMpi_) MPI_Finalize();
+#endif
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Optimize radii with the current globals, input_ gets the best
+// design. Returns its fitness.
+double OptimizeInput() {
+  int rank = communicator_->Rank();
+  SetOptimizer();
+  // std::vector<double> feed = {input_[0],input_[1]};
+  // sub_population_.SetFeed({feed});
+  if (rank == 0 && distribution_level_ == 3 && checkpoint_interval_ > 0)
+    printf("Distribution level 3 neither writes nor restores checkpoints.\n");
+  if (sub_population_.RestoreCheckpoint(checkpoint_name_) == jade::kDone) {
+    if (rank == 0) printf("Restored from checkpoint.\n");
+  } else if (quasi_static_generations_ > 0) {
+    isQuasiStaticStage_ = true;
+    SetOptimizer();
+    sub_population_.RunOptimization();
+    double fitness = 0.0;
+    auto best_x = sub_population_.GetBest(&fitness);
+    if (rank == 0) printf("Quasi-static stage fitness: %g\n", fitness);
+    isQuasiStaticStage_ = false;
+    SetOptimizer();
+    sub_population_.SetFeed({best_x});
+  }
+  sub_population_.RunOptimization();
+  if (rank == 0 && sub_population_.GetRestarts() > 0)
+    printf("Restarted %li times.\n", sub_population_.GetRestarts());
+  if (polish_evaluations_ > 0 && !isParetoFront_) {
+    sub_population_.PolishBest(polish_evaluations_, polish_tolerance_);
+    if (rank == 0)
+      printf("Polished with %li evaluations.\n",
+             sub_population_.GetPolishEvaluations());
+  }
+  double fitness = 0.0;
+  auto best_x  = sub_population_.GetBest(&fitness);
+  if (isParetoFront_) best_x = WriteParetoFront(&fitness);
+  if (rank == 0)
+    printf("Fitness cache hits: %li, misses: %li\n",
+           sub_population_.GetFitnessCacheHits(),
+           sub_population_.GetFitnessCacheMisses());
+  for (int i = 0; i< best_x.size(); ++i)
+    input_[i] = best_x[i];
+  return fitness;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Job of the farm, see farm_jobs_name_.
+struct FarmJob {
+  std::string name;
+  double lower_bound = 0.0, upper_bound = 0.0;
+  std::complex<double> core_epsilon, metal_epsilon, outshell_epsilon;
+  double omega = 1.0;  // in units of omega_0_
+  std::vector<double> band_omega;
+  bool isBandWorstCase = false, isParetoFront = false;
+  long population_size = 0, total_generations = 0;
+  std::string telemetry_name, population_dump_name;
+};
+// Job with current values of the globals, metal_ is assumed to be
+// nondispersive.
+FarmJob GetCurrentFarmJob() {
+  FarmJob job;
+  job.lower_bound = lower_bound_;
+  job.upper_bound = upper_bound_;
+  job.core_epsilon = core_index_*core_index_;
+  job.metal_epsilon = metal_.GetEpsilon(omega_0_);
+  job.outshell_epsilon = outshell_index_*outshell_index_;
+  job.omega = input_[3];
+  job.band_omega = band_omega_;
+  job.isBandWorstCase = isBandWorstCase_;
+  job.isParetoFront = isParetoFront_;
+  job.population_size = population_size_ > 0 ? population_size_
+    : dim_*population_multiplicator_;
+  job.total_generations = total_generations_;
+  job.telemetry_name = telemetry_name_;
+  job.population_dump_name = population_dump_name_;
+  return job;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Comma separated numbers.
+std::vector<double> ParseNumbers(const std::string &text) {
+  std::vector<double> numbers;
+  const char *begin = text.c_str();
+  while (true) {
+    char *end = nullptr;
+    numbers.push_back(std::strtod(begin, &end));
+    if (end == begin) throw std::invalid_argument("Wrong number in " + text);
+    if (*end == '\0') break;
+    if (*end != ',') throw std::invalid_argument("Wrong number in " + text);
+    begin = end + 1;
+  }
+  return numbers;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// All processes read the same file, so that wrong jobs stop all
+// of them before the farm starts.
+std::vector<FarmJob> ReadFarmJobs(const std::string &file_name) {
+  std::FILE *file = std::fopen(file_name.c_str(), "r");
+  if (file == nullptr) throw std::invalid_argument("Can not open " + file_name);
+  const FarmJob defaults = GetCurrentFarmJob();
+  std::vector<FarmJob> jobs;
+  std::string line;
+  for (int c = std::fgetc(file); c != EOF || !line.empty(); c = std::fgetc(file)) {
+    if (c != '\n' && c != EOF) {
+      line.push_back(static_cast<char>(c));
+      continue;
+    }
+    std::vector<std::string> words;
+    std::string word;
+    for (char symbol : line + " ") {
+      if (std::isspace(static_cast<unsigned char>(symbol))) {
+        if (!word.empty()) words.push_back(word);
+        word.clear();
+      } else {
+        word.push_back(symbol);
+      }
+    }
+    line.clear();
+    if (words.empty() || words[0][0] == '#') continue;
+    FarmJob job = defaults;
+    job.name = "job" + std::to_string(jobs.size());
+    for (const auto &pair : words) {
+      const auto equal = pair.find('=');
+      if (equal == std::string::npos)
+        throw std::invalid_argument("Wrong job parameter " + pair);
+      const std::string key = pair.substr(0, equal);
+      const std::string value = pair.substr(equal + 1);
+      auto get_complex = [&]() {
+        auto numbers = ParseNumbers(value);
+        if (numbers.size() != 2)
+          throw std::invalid_argument("Wrong permittivity " + pair);
+        return std::complex<double>(numbers[0], numbers[1]);
+      };
+      auto get_number = [&]() {
+        auto numbers = ParseNumbers(value);
+        if (numbers.size() != 1)
+          throw std::invalid_argument("Wrong job parameter " + pair);
+        return numbers[0];
+      };
+      if (key == "name") job.name = value;
+      else if (key == "lower") job.lower_bound = get_number();
+      else if (key == "upper") job.upper_bound = get_number();
+      else if (key == "core") job.core_epsilon = get_complex();
+      else if (key == "metal") job.metal_epsilon = get_complex();
+      else if (key == "outshell") job.outshell_epsilon = get_complex();
+      else if (key == "lambda") job.omega = lambda_0_/(get_number()*1.0e-9);
+      else if (key == "band") job.band_omega = ParseNumbers(value);
+      else if (key == "worst") job.isBandWorstCase = get_number() != 0.0;
+      else if (key == "pareto") job.isParetoFront = get_number() != 0.0;
+      else if (key == "population") job.population_size = get_number();
+      else if (key == "generations") job.total_generations = get_number();
+      else throw std::invalid_argument("Unknown job parameter " + pair);
+    }
+    if (!(job.lower_bound > 0.0) || !(job.upper_bound > job.lower_bound)
+        || !(job.omega > 0.0) || job.population_size < 1
+        || job.total_generations < 1
+        || !std::is_sorted(job.band_omega.begin(), job.band_omega.end()))
+      throw std::invalid_argument("Wrong job " + job.name);
+    for (const auto &other : jobs)
+      if (other.name == job.name)
+        throw std::invalid_argument("Repeated job name " + job.name);
+    // Ranks of a job are local to its group, so files need job names.
+    if (!job.telemetry_name.empty())
+      job.telemetry_name = job.name + "-" + job.telemetry_name;
+    if (!job.population_dump_name.empty())
+      job.population_dump_name = job.name + "-" + job.population_dump_name;
+    jobs.push_back(job);
+  }
+  std::fclose(file);
+  return jobs;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Optimize job with processes of communicator_, returns its line of
+// farm output.
+std::string RunFarmJob(const FarmJob &job) {
+  const double start = jade::Communicator::GetTime();
+  lower_bound_ = job.lower_bound;
+  upper_bound_ = job.upper_bound;
+  core_index_ = std::sqrt(job.core_epsilon);
+  outshell_index_ = std::sqrt(job.outshell_epsilon);
+  metal_ = material::ConstantMaterial(job.metal_epsilon);
+  metal_index_table_.Init(metal_, from_omega_, to_omega_, samples_);
+  ++materials_version_;
+  input_ = {eps_, eps_, eps_, job.omega};
+  band_omega_ = job.band_omega;
+  isBandWorstCase_ = job.isBandWorstCase;
+  isParetoFront_ = job.isParetoFront;
+  population_size_ = job.population_size;
+  total_generations_ = job.total_generations;
+  checkpoint_name_ = job.name + "-checkpoint";
+  pareto_name_ = job.name + "-pareto";
+  telemetry_name_ = job.telemetry_name;
+  population_dump_name_ = job.population_dump_name;
+  sub_population_.SwitchOffOutput();
+  double fitness = OptimizeInput();
+  SetGeometry(&input_);
+  PreparedMie mie;
+  mie.SetTolerance(mie_tolerance_, 0.0);
+  mie.SetInput(input_);
+  mie.RunMieCalculation();
+  char buffer[256];
+  std::snprintf(buffer, sizeof(buffer),
+                "%-24s %24.16e %24.16e %24.16e %22.16e %22.16e %22.16e %10.2f\n",
+                job.name.c_str(), fitness, mie.GetQabs(), mie.GetQsca(),
+                input_[0], input_[1], input_[2],
+                jade::Communicator::GetTime() - start);
+  return buffer;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+#ifdef JADE_WITH_MPI
+const int kFarmResultTag = 1, kFarmJobTag = 2;
+// Process 0 answers each result (empty for the first request) of a
+// group leader with the index of the next job, or -1 if there is none.
+void RunFarmDispatcher(long jobs, int groups, std::FILE *file) {
+  long next = 0;
+  std::vector<char> result;
+  while (groups > 0) {
+    MPI_Status status;
+    MPI_Probe(MPI_ANY_SOURCE, kFarmResultTag, MPI_COMM_WORLD, &status);
+    int size = 0;
+    MPI_Get_count(&status, MPI_CHAR, &size);
+    result.resize(std::max(1, size));
+    MPI_Recv(result.data(), size, MPI_CHAR, status.MPI_SOURCE, kFarmResultTag,
+             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (size > 0) {
+      std::fwrite(result.data(), 1, size, file);
+      std::fflush(file);
+    }
+    long job = next < jobs ? next++ : -1;
+    if (job < 0) --groups;
+    MPI_Send(&job, 1, MPI_LONG, status.MPI_SOURCE, kFarmJobTag, MPI_COMM_WORLD);
+  }
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void RunFarmGroup(const std::vector<FarmJob> &jobs, MPI_Comm group) {
+  communicator_ = std::make_shared<jade::MpiCommunicator>(group);
+  std::string result;
+  while (true) {
+    long job = -1;
+    if (communicator_->Rank() == 0) {
+      MPI_Send(result.data(), result.size(), MPI_CHAR, 0, kFarmResultTag,
+               MPI_COMM_WORLD);
+      MPI_Recv(&job, 1, MPI_LONG, 0, kFarmJobTag, MPI_COMM_WORLD,
+               MPI_STATUS_IGNORE);
+    }
+    communicator_->Broadcast(&job, 1, 0);
+    if (job < 0) break;
+    result = RunFarmJob(jobs[job]);
+  }
+}
+#endif
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Process 0 only deals jobs and writes results, the others are split
+// into groups of processes_per_job_ (spare ones stay idle).
+void RunFarm() {
+  const int rank = communicator_->Rank();
+  if (processes_per_job_ < 1)
+    throw std::invalid_argument("Wrong number of processes per job!");
+  const auto jobs = ReadFarmJobs(farm_jobs_name_);
+  std::FILE *file = nullptr;
+  if (rank == 0) {
+    file = std::fopen(farm_name_.c_str(), "w");
+    if (file == nullptr) throw std::invalid_argument("Can not open " + farm_name_);
+    std::fprintf(file, "# %-22s %24s %24s %24s %22s %22s %22s %10s\n", "name",
+                 "fitness", "Qabs", "Qsca", "r1", "r2", "r3", "seconds");
+    std::fflush(file);
+  }
+#ifdef JADE_WITH_MPI
+  const int processes = communicator_->Size();
+  if (isMpi_ && processes > 1) {
+    const int groups = (processes - 1)/processes_per_job_;
+    if (groups < 1)
+      throw std::invalid_argument("Farm needs processes_per_job_ + 1 processes!");
+    int color = rank == 0 || rank > groups*processes_per_job_
+      ? MPI_UNDEFINED : (rank - 1)/processes_per_job_;
+    MPI_Comm group;
+    MPI_Comm_split(MPI_COMM_WORLD, color, rank, &group);
+    if (rank == 0) {
+      printf("Farm of %zu jobs on %i groups of %i processes.\n", jobs.size(),
+             groups, processes_per_job_);
+      RunFarmDispatcher(jobs.size(), groups, file);
+      std::fclose(file);
+    } else if (group != MPI_COMM_NULL) {
+      RunFarmGroup(jobs, group);
+      MPI_Comm_free(&group);
+    }
+    return;
+  }
+#endif
+  for (const auto &job : jobs) {
+    std::string result = RunFarmJob(job);
+    std::fputs(result.c_str(), file);
+    std::fflush(file);
+  }
+  std::fclose(file);
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+double EvaluateFitness(const std::vector<double> &x) {
+  // Is called from several threads at once, so no globals are
+  // changed and each thread owns its prepared Mie problem.
+  thread_local PreparedMie mie;
+  thread_local std::vector<double> Qsca, Qabs;
+  mie.SetTolerance(mie_tolerance_, isQuasiStaticStage_
+                   ? HUGE_VAL : quasi_static_tolerance_);
+  mie.SetInput(x);
+  double r_outer = mie.GetInput()[2]*lambda_0_;
+  double fitness = 0.0;
   try {
-    multi_layer_mie_.RunMieCalculation();
-    Zeta = multi_layer_mie_.GetQabs()/multi_layer_mie_.GetQsca();
+    if (band_omega_.empty()) {
+      mie.RunMieCalculation();
+      fitness = PointFitness(mie.GetQsca(), mie.GetQabs(), r_outer);
+    } else {
+      mie.RunBand(band_omega_, &Qsca, &Qabs);
+      fitness = BandFitness(Qsca, Qabs, r_outer);
+    }
   } catch( const std::invalid_argument& ia ) {
     printf(".");
-    sub_population_.GetWorst(&Zeta);
+    sub_population_.CountFailedEvaluation();
+    sub_population_.GetWorst(&fitness);
+  }
+  return fitness;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Same model as EvaluateFitness() with a single batch for all x, is
+// called from one thread.
+void EvaluateFitnessBatch(const std::vector< std::vector<double> > &x,
+                          std::vector<double> &fitness) {
+  static PreparedMie mie;
+  static std::vector<mie_batch::Target> targets;
+  static std::vector<mie_batch::Efficiency> efficiency;
+  static std::vector<double> r_outer, Qsca, Qabs;
+  const unsigned int band = std::max<std::size_t>(1, band_omega_.size());
+  mie.SetTolerance(mie_tolerance_, 0.0);
+  targets.clear();
+  r_outer.clear();
+  for (const auto &input : x) {
+    mie.SetInput(input);
+    mie.AddBatchTargets(band_omega_, &targets);
+    r_outer.push_back(mie.GetInput()[2]*lambda_0_);
+  }
+  mie_batch::RunBatch(targets, &efficiency);
+  fitness.resize(x.size());
+  Qsca.resize(band);
+  Qabs.resize(band);
+  for (unsigned int n = 0; n < x.size(); ++n) {
+    bool isFailed = false;
+    for (unsigned int k = 0; k < band; ++k) {
+      Qsca[k] = efficiency[n*band + k].Qsca;
+      Qabs[k] = efficiency[n*band + k].Qabs;
+      if (std::isnan(Qsca[k]) || std::isnan(Qabs[k])) isFailed = true;
+    }
+    if (isFailed) {
+      printf(".");
+      sub_population_.CountFailedEvaluation();
+      sub_population_.GetWorst(&fitness[n]);
+      continue;
+    }
+    fitness[n] = band_omega_.empty() ? PointFitness(Qsca[0], Qabs[0], r_outer[n])
+        : BandFitness(Qsca, Qabs, r_outer[n]);
+  }
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Same model as EvaluateFitness(), objectives are {Qabs, Zeta}.
+void EvaluateObjectives(const std::vector<double> &x,
+                        std::vector<double> &objectives) {
+  thread_local PreparedMie mie;
+  thread_local std::vector<double> Qsca, Qabs, Zeta;
+  mie.SetTolerance(mie_tolerance_, isQuasiStaticStage_
+                   ? HUGE_VAL : quasi_static_tolerance_);
+  mie.SetInput(x);
+  objectives.resize(2);
+  try {
+    if (band_omega_.empty()) {
+      mie.RunMieCalculation();
+      objectives[0] = mie.GetQabs();
+      objectives[1] = mie.GetQabs()/mie.GetQsca();
+    } else {
+      mie.RunBand(band_omega_, &Qsca, &Qabs);
+      Zeta.resize(Qabs.size());
+      for (unsigned int k = 0; k < Qabs.size(); ++k) Zeta[k] = Qabs[k]/Qsca[k];
+      objectives[0] = BandAverage(Qabs);
+      objectives[1] = BandAverage(Zeta);
+    }
+  } catch( const std::invalid_argument& ia ) {
+    printf(".");
+    sub_population_.CountFailedEvaluation();
+    // Both objectives are positive, so failed design is dominated.
+    objectives[0] = objectives[1] = 0.0;
+  }
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Returns the compromise design of the front, its fitness is the
+// scalar objective of non-Pareto runs.
+std::vector<double> WriteParetoFront(double *fitness_ptr) {
+  int rank = communicator_->Rank();
+  std::vector< std::vector<double> > objectives;
+  auto front = sub_population_.GetParetoFront(&objectives);
+  gnuplot::GnuplotWrapper wrapper;
+  wrapper.SetPlotName(pareto_name_);
+  wrapper.SetDrawStyle("w lp pt 7");
+  wrapper.SetXLabelName("Qabs");
+  wrapper.SetYLabelName("Zeta");
+  wrapper.AddColumnName("Qabs");
+  wrapper.AddColumnName("Zeta");
+  if (rank == 0) printf("Pareto front:\n%12s %12s  radii\n", "Qabs", "Zeta");
+  unsigned int best = 0;
+  double best_fitness = 0.0;
+  for (unsigned int k = 0; k < front.size(); ++k) {
+    double Qabs = objectives[k][0], Zeta = objectives[k][1];
+    std::vector<double> input = input_;
+    std::copy(front[k].begin(), front[k].end(), input.begin());
+    SetGeometry(&input);
+    // Band objectives are averages, so the compromise is ranked by
+    // the band fitness of the design, as in scalar band optimization.
+    double fitness = band_omega_.empty()
+      ? PointFitness(Qabs/Zeta, Qabs, input[2]*lambda_0_)
+      : EvaluateFitness(front[k]);
+    if (k == 0 || fitness > best_fitness) {
+      best = k;
+      best_fitness = fitness;
+    }
+    wrapper.AddMultiPoint(objectives[k]);
+    if (rank != 0) continue;
+    printf("%12g %12g ", Qabs, Zeta);
+    for (auto value : front[k]) printf(" %g", value);
+    printf("\n");
   }
-  double r_outer = input_[2]*lambda_0_;
-  double Qabs = multi_layer_mie_.GetQabs();
-  double Cabs = Qabs*pi*pow2(r3_);
+  if (rank == 0) wrapper.MakeOutput();
+  if (front.empty()) throw std::invalid_argument("Empty Pareto front!");
+  *fitness_ptr = best_fitness;
+  return front[best];
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void RunFitnessBenchmark() {
+  int rank = communicator_->Rank();
+  // Failed evaluations use the population of the optimizer.
+  SetOptimizer();
+  std::mt19937 generator(rank + 1);
+  std::uniform_real_distribution<double> radius(lower_bound_, upper_bound_);
+  std::vector< std::vector<double> > inputs(fitness_benchmark_calls_,
+                                            std::vector<double>(dim_));
+  for (auto &x : inputs)
+    for (auto &value : x) value = radius(generator);
+  EvaluateFitness(inputs.front());  // Warm up.
+  double sum = 0.0;
+  double start = jade::Communicator::GetTime();
+  for (const auto &x : inputs) sum += EvaluateFitness(x);
+  double time = jade::Communicator::GetTime() - start, max_time = 0.0;
+  communicator_->AllReduceMax(&time, 1, &max_time);
+  if (rank == 0)
+    printf("\nEvaluateFitness: %li calls, %g us per call (sum %g)\n",
+           fitness_benchmark_calls_, max_time/fitness_benchmark_calls_*1e6,
+           sum);
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+double PointFitness(double Qsca, double Qabs, double r_outer) {
+  double Zeta = Qabs/Qsca;
+  double Cabs = Qabs*pi*pow2(r_outer);
   double A = 3.0*pow2(lambda_0_)/(8.0*pi);
   double Q0 = 5.0, Z0=1000.0;
 
@@ -187,33 +868,324 @@ double EvaluateFitness(std::vector<double> input) {
 // ********************************************************************** //
 // ********************************************************************** //
 // ********************************************************************** //
-void SetGeometry() {
+double BandFitness(const std::vector<double> &Qsca,
+                   const std::vector<double> &Qabs, double r_outer) {
+  thread_local std::vector<double> fitness;
+  fitness.resize(band_omega_.size());
+  for (unsigned int k = 0; k < band_omega_.size(); ++k)
+    fitness[k] = PointFitness(Qsca[k], Qabs[k], r_outer);
+  return BandAverage(fitness);
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Mean (trapezoidal rule) or the worst of values at band_omega_.
+double BandAverage(const std::vector<double> &values) {
+  if (band_omega_.size() == 1) return values[0];
+  double worst = values[0], integral = 0.0;
+  for (unsigned int k = 1; k < band_omega_.size(); ++k) {
+    // Values are maximized, so the worst is the smallest.
+    worst = std::min(worst, values[k]);
+    integral += 0.5*(values[k-1] + values[k])*(band_omega_[k] - band_omega_[k-1]);
+  }
+  if (isBandWorstCase_) return worst;
+  return integral/(band_omega_.back() - band_omega_.front());
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Fix order of radii in optimizer input.
+void SetGeometry(std::vector<double> *input_ptr) {
+  std::vector<double> &input = *input_ptr;
   if (isOuterR) {
-    input_[2] = outer_r_;
-    if (input_[0] > input_[2]) input_[0] = input_[2]-2.0*eps_;
-    if (input_[1] > input_[2]) input_[1] = input_[2]-eps_;
+    input[2] = outer_r_;
+    if (input[0] > input[2]) input[0] = input[2]-2.0*eps_;
+    if (input[1] > input[2]) input[1] = input[2]-eps_;
   }
-  if (input_[1] < input_[0]) input_[1] = input_[0]+eps_;
-  if (input_[2] < input_[1]) input_[2] = input_[1]+eps_;
+  if (input[1] < input[0]) input[1] = input[0]+eps_;
+  if (input[2] < input[1]) input[2] = input[1]+eps_;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void PreparedMie::SetInput(const std::vector<double> &input) {
+  // Optimizer input has radii only, frequency and other missing
+  // components are taken from the preset ::input_. Assignment reuses
+  // memory after the first call.
+  input_ = ::input_;
+  std::copy(input.begin(), input.end(), input_.begin());
+  SetGeometry(&input_);
   r1_ = input_[0]*lambda_0_;
   r2_ = input_[1]*lambda_0_;
   r3_ = input_[2]*lambda_0_;
-  omega_ = input_[3]*omega_0_;
-  core_width_ = r1_;
-  inshell_width_ = r2_ - r1_;
-  outshell_width_ = r3_ - r2_;
+  double omega = input_[3]*omega_0_;
+  if (materials_version_ != ::materials_version_) {
+    materials_version_ = ::materials_version_;
+    omega_ = -1.0;
+    band_.clear();
+  }
+  if (omega != omega_) {
+    omega_ = omega;
+    metal_index_ = metal_index_table_.GetIndex(omega);
+  }
+  SetTarget(omega, metal_index_);
 }
 // ********************************************************************** //
 // ********************************************************************** //
 // ********************************************************************** //
-void SetMie() {
-      multi_layer_mie_.ClearTarget();
-      multi_layer_mie_.AddTargetLayer(core_width_, core_index_);
-      multi_layer_mie_.AddTargetLayer(inshell_width_, std::sqrt(epsilon_m(omega_)));
-      // if (omega_ > omega_0_*0.999 && omega_ < omega_0_*1.001)
-      // 	printf("eps = %g, %gj",epsilon_m(omega_).real(), epsilon_m(omega_).imag());
-      multi_layer_mie_.AddTargetLayer(outshell_width_, outshell_index_);
-      multi_layer_mie_.SetWavelength(w2l(omega_));
+void PreparedMie::RunBand(const std::vector<double> &band,
+                          std::vector<double> *Qsca,
+                          std::vector<double> *Qabs) {
+  SetBand(band);
+  Qsca->resize(band_.size());
+  Qabs->resize(band_.size());
+  for (unsigned int k = 0; k < band_.size(); ++k) {
+    SetTarget(band_[k]*omega_0_, band_metal_index_[k]);
+    RunMieCalculation();
+    (*Qsca)[k] = GetQsca();
+    (*Qabs)[k] = GetQabs();
+  }
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void PreparedMie::AddBatchTargets(const std::vector<double> &band,
+                                  std::vector<mie_batch::Target> *targets) {
+  const double r[] = {r1_, r2_, r3_};
+  auto add_target = [&]() {
+    mie_batch::Target target;
+    target.layers = 3;
+    target.max_terms = GetMaxTerms();
+    const std::complex<double> index[] = {
+      core_index_, target_metal_index_, outshell_index_};
+    for (int l = 0; l < 3; ++l) {
+      target.size_parameter[l] = 2.0*pi*r[l]/wavelength_;
+      target.index_re[l] = index[l].real();
+      target.index_im[l] = index[l].imag();
+    }
+    targets->push_back(target);
+  };
+  if (band.empty()) {
+    add_target();
+    return;
+  }
+  SetBand(band);
+  for (unsigned int k = 0; k < band_.size(); ++k) {
+    SetTarget(band_[k]*omega_0_, band_metal_index_[k]);
+    add_target();
+  }
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Dispersive indexes are computed only if band changes.
+void PreparedMie::SetBand(const std::vector<double> &band) {
+  if (band == band_) return;
+  band_ = band;
+  band_metal_index_.resize(band_.size());
+  for (unsigned int k = 0; k < band_.size(); ++k)
+    band_metal_index_[k] = metal_index_table_.GetIndex(band_[k]*omega_0_);
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void PreparedMie::SetTolerance(double terms_tolerance,
+                               double quasi_static_tolerance) {
+  if (terms_tolerance < 0.0 || quasi_static_tolerance < 0.0)
+    throw std::invalid_argument("Wrong Mie tolerance!");
+  terms_tolerance_ = terms_tolerance;
+  quasi_static_tolerance_ = quasi_static_tolerance;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void PreparedMie::RunMieCalculation() {
+  isQuasiStatic_ = quasi_static_tolerance_ > 0.0
+    && GetQuasiStatic(&Qsca_, &Qabs_) < quasi_static_tolerance_;
+  if (isQuasiStatic_) return;
+  mie_.SetMaxTerms(GetMaxTerms());
+  mie_.RunMieCalculation();
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+double PreparedMie::GetIndexSizeParameter() const {
+  double index = std::max(1.0, std::abs(core_index_));
+  index = std::max(index, std::abs(target_metal_index_));
+  index = std::max(index, std::abs(outshell_index_));
+  return 2.0*pi*r3_/wavelength_*index;
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+int PreparedMie::GetMaxTerms() const {
+  if (terms_tolerance_ == 0.0) return -1;  // nmie default
+  double x = GetIndexSizeParameter();
+  // Wiscombe criterion is enough for any size.
+  int wiscombe = static_cast<int>(std::ceil(x + 4.05*std::cbrt(x) + 2.0));
+  if (x >= 1.0) return wiscombe;
+  // For small spheres term n is about x^(2n-2) of the dipole one.
+  int terms = static_cast<int>(std::ceil(std::log(terms_tolerance_)
+                                         /(2.0*std::log(x))));
+  return std::max(1, std::min(terms, wiscombe));
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Layers are replaced from the core outwards by a sphere of effective
+// permittivity with the same electrostatic polarizability.
+double PreparedMie::GetQuasiStatic(double *Qsca, double *Qabs) const {
+  const std::complex<double> epsilon[] = {
+    core_index_*core_index_, target_metal_index_*target_metal_index_,
+    outshell_index_*outshell_index_};
+  const double r[] = {r1_, r2_, r3_};
+  std::complex<double> epsilon_eff = epsilon[0];
+  for (int l = 1; l < 3; ++l) {
+    double f = std::pow(r[l-1]/r[l], 3);
+    std::complex<double> sum = epsilon_eff + 2.0*epsilon[l];
+    std::complex<double> diff = epsilon_eff - epsilon[l];
+    epsilon_eff = epsilon[l]*(sum + 2.0*f*diff)/(sum - f*diff);
+  }
+  // Polarizability in units of 4 pi r^3 in vacuum.
+  std::complex<double> alpha = (epsilon_eff - 1.0)/(epsilon_eff + 2.0);
+  double x = 2.0*pi*r3_/wavelength_;
+  *Qabs = 4.0*x*alpha.imag();
+  *Qsca = 8.0/3.0*pow2(pow2(x))*std::norm(alpha);
+  return pow2(GetIndexSizeParameter());
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+void PreparedMie::SetTarget(double omega, std::complex<double> metal_index) {
+  // Layer vectors are cleared, not released, so adding the same
+  // number of layers does not allocate.
+  mie_.ClearTarget();
+  mie_.AddTargetLayer(r1_, core_index_);
+  mie_.AddTargetLayer(r2_ - r1_, metal_index);
+  // if (omega > omega_0_*0.999 && omega < omega_0_*1.001)
+  // 	printf("eps = %g, %gj",metal_.GetEpsilon(omega).real(), metal_.GetEpsilon(omega).imag());
+  mie_.AddTargetLayer(r3_ - r2_, outshell_index_);
+  wavelength_ = w2l(omega);
+  target_metal_index_ = metal_index;
+  mie_.SetWavelength(wavelength_);
+}
+// ********************************************************************** //
+// ********************************************************************** //
+// ********************************************************************** //
+// Frequencies are dealt to MPI processes round robin, as
+// calculation time grows with frequency, and each process evaluates
+// its share with threads_per_process_ threads or as one mie_batch
+// batch.
+void RunSpectrum(const std::vector<double> &input) {
+  const int rank = communicator_->Rank();
+  const int processes = communicator_->Size();
+  auto get_local_samples = [&](int p) -> long {
+    return samples_ > p ? (samples_ - p + processes - 1)/processes : 0;
+  };
+  const long local_samples = get_local_samples(rank);
+  std::vector<double> spectrum(local_samples*kSpectrumColumns);
+  auto get_omega = [&](long j) {
+    long k = rank + j*processes;
+    return samples_ > 1
+      ? from_omega_ + (to_omega_ - from_omega_)*k/(samples_ - 1)
+      : from_omega_;
+  };
+  if (isMieBatch_) {
+    PreparedMie mie;
+    std::vector<double> x = input;
+    std::vector<mie_batch::Target> targets;
+    std::vector<mie_batch::Efficiency> efficiency;
+    for (long j = 0; j < local_samples; ++j) {
+      x[3] = get_omega(j)/omega_0_;
+      mie.SetInput(x);
+      mie.AddBatchTargets({}, &targets);
+      spectrum[j*kSpectrumColumns] = x[3];
+    }
+    mie_batch::RunBatch(targets, &efficiency);
+    for (long j = 0; j < local_samples; ++j) {
+      spectrum[j*kSpectrumColumns + 1] = efficiency[j].Qsca;
+      spectrum[j*kSpectrumColumns + 2] = efficiency[j].Qabs;
+    }
+  } else {
+    jade::ThreadPool thread_pool;
+    thread_pool.Resize(threads_per_process_);
+    thread_pool.Run(local_samples, [&](long j) {
+        thread_local PreparedMie mie;
+        thread_local std::vector<double> x;
+        x = input;
+        x[3] = get_omega(j)/omega_0_;
+        mie.SetInput(x);
+        double *row = &spectrum[j*kSpectrumColumns];
+        row[0] = x[3];
+        try {
+          mie.RunMieCalculation();
+          row[1] = mie.GetQsca();
+          row[2] = mie.GetQabs();
+        } catch( const std::invalid_argument& ia ) {
+          row[1] = row[2] = std::nan("");
+        }
+      });
+  }
+#ifdef JADE_WITH_MPI
+  if (isSpectrumBinary_ && isMpi_) {
+    // Each process writes its rows to their places in the file.
+    MPI_File file;
+    MPI_Datatype rows;
+    std::string file_name = spectrum_name_ + ".bin";
+    MPI_Type_vector(local_samples, kSpectrumColumns,
+                    kSpectrumColumns*processes, MPI_DOUBLE, &rows);
+    MPI_Type_commit(&rows);
+    MPI_File_open(MPI_COMM_WORLD, file_name.c_str(),
+                  MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    MPI_File_set_size(file, 0);
+    MPI_File_set_view(file, rank*kSpectrumColumns*sizeof(double), MPI_DOUBLE,
+                      rows, "native", MPI_INFO_NULL);
+    MPI_File_write_all(file, spectrum.data(), spectrum.size(), MPI_DOUBLE,
+                       MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+    MPI_Type_free(&rows);
+    return;
+  }
+#endif
+  std::vector<double> all;
+  communicator_->AllGatherVariable(spectrum, &all);
+  if (rank != 0) return;
+  std::vector<long> displacements(processes, 0);
+  for (int p = 1; p < processes; ++p)
+    displacements[p] = displacements[p-1]
+      + get_local_samples(p-1)*kSpectrumColumns;
+  // Restore frequency order from round robin sharing.
+  auto get_row = [&](long k) {
+    return &all[displacements[k % processes]
+                + (k/processes)*kSpectrumColumns];
+  };
+  if (isSpectrumBinary_) {
+    std::string file_name = spectrum_name_ + ".bin";
+    FILE *file = std::fopen(file_name.c_str(), "wb");
+    if (file == nullptr)
+      throw std::invalid_argument("Can not open " + file_name);
+    for (long k = 0; k < samples_; ++k)
+      std::fwrite(get_row(k), sizeof(double), kSpectrumColumns, file);
+    std::fclose(file);
+    return;
+  }
+  gnuplot::GnuplotWrapper wrapper;
+  wrapper.SetPlotName(spectrum_name_);
+  wrapper.SetStreaming(false);
+  wrapper.SetXLabelName("omega/omega_0");
+  wrapper.SetYLabelName("Q");
+  wrapper.AddColumnName("omega/omega_0");
+  wrapper.AddColumnName("Qsca");
+  wrapper.AddColumnName("Qabs");
+  double plot_from = l2w(std::max(plot_from_wl_, plot_to_wl_))/omega_0_;
+  double plot_to = l2w(std::min(plot_from_wl_, plot_to_wl_))/omega_0_;
+  wrapper.SetXRange({plot_from, plot_to});
+  long stride = std::max(1, samples_/std::max(1, plot_samples_));
+  for (long k = 0; k < samples_; k += stride) {
+    const double *row = get_row(k);
+    wrapper.AddMultiPoint(std::vector<double>(row, row + kSpectrumColumns));
+  }
+  wrapper.MakeOutput();
 }
 // ********************************************************************** //
 // ********************************************************************** //
@@ -222,14 +1194,38 @@ void SetOptimizer() {
   //Width is optimized for two layers only!!
   //The third one fills to total_r_
   long dimension = dim_;
+  sub_population_.SetCommunicator(communicator_);
   sub_population_.FitnessFunction = &EvaluateFitness;
-  long total_population = dimension * population_multiplicator_;
+  sub_population_.ObjectivesFunction = &EvaluateObjectives;
+  sub_population_.BatchFitnessFunction = isMieBatch_ && !isQuasiStaticStage_
+    && quasi_static_tolerance_ == 0.0 ? &EvaluateFitnessBatch : nullptr;
+  long total_population = population_size_ > 0 ? population_size_
+    : dimension * population_multiplicator_;
   sub_population_.Init(total_population, dimension);
+  sub_population_.SetObjectives(isParetoFront_ ? 2 : 0);
+  sub_population_.SetDistributionLevel(distribution_level_);
+  sub_population_.SetNumberOfThreads(threads_per_process_);
+  // Only the full model stage is restored after restart, so the
+  // quasi-static stage should not overwrite its checkpoint.
+  sub_population_.SetCheckpoint(checkpoint_name_, isQuasiStaticStage_
+                                ? 0 : checkpoint_interval_);
+  sub_population_.SetFitnessCache(fitness_cache_size_, eps_, true);
+  sub_population_.SetStagnationStop(stagnation_tolerance_,
+                                    stagnation_generations_);
+  sub_population_.SetRestarts(restarts_, restart_population_factor_,
+                              restart_elites_);
+  sub_population_.SetPopulationReduction(population_minimum_);
+  sub_population_.SetSurrogate(surrogate_share_, surrogate_neighbours_, 1.0);
+  sub_population_.SetTelemetry(telemetry_name_);
+  sub_population_.SetPopulationDump(population_dump_name_,
+                                    population_dump_interval_);
   /// Low and upper bound for all dimenstions;
-  sub_population_.SetAllBounds(eps_, 2.0-eps_);
+  sub_population_.SetAllBounds(lower_bound_, upper_bound_);
   //sub_population_.SetAllBounds(eps_, input_[2]-eps_);
   sub_population_.SetTargetToMaximum();
-  sub_population_.SetTotalGenerationsMax(total_generations_);
+  sub_population_.SetTotalGenerationsMax(isQuasiStaticStage_
+                                         ? quasi_static_generations_
+                                         : total_generations_);
   //sub_population.SwitchOffPMCRADE();
 
   sub_population_.SetBestShareP(0.1);
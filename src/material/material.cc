@@ -0,0 +1,132 @@
+///
+/// @file   material.cc
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// material is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// material is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with material.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Dispersive materials and precomputed tables of their
+/// refractive index.
+///
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "material.h"
+namespace material {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void LorentzMaterial::AddOscillator(double omega_p, double omega_0,
+                                      double gamma) {
+    if (omega_p < 0.0 || omega_0 < 0.0 || gamma < 0.0)
+      throw std::invalid_argument("Wrong Lorentz oscillator!");
+    oscillators_.push_back({omega_p*omega_p, omega_0*omega_0, gamma});
+  }  // end of void LorentzMaterial::AddOscillator()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::complex<double> LorentzMaterial::GetEpsilon(double omega) const {
+    std::complex<double> epsilon(epsilon_infinity_, 0.0);
+    for (const auto &oscillator : oscillators_)
+      epsilon += oscillator.omega_p2 / std::complex<double>(
+          oscillator.omega_02 - omega*omega, -oscillator.gamma*omega);
+    return epsilon;
+  }  // end of std::complex<double> LorentzMaterial::GetEpsilon()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void TabulatedMaterial::Read(std::string file_name, double wavelength_unit) {
+    std::ifstream file(file_name);
+    if (!file) throw std::invalid_argument("Can not open " + file_name);
+    std::vector< std::pair<double, std::complex<double> > > rows;
+    std::string line;
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#') continue;
+      std::istringstream values(line);
+      double wavelength, n, k;
+      if (!(values >> wavelength >> n >> k) || !(wavelength > 0.0))
+        throw std::invalid_argument("Wrong line in " + file_name + ": " + line);
+      rows.push_back({2.0*kPi*kSpeedOfLight/(wavelength*wavelength_unit),
+              std::complex<double>(n, k)});
+    }
+    if (rows.empty()) throw std::invalid_argument("No data in " + file_name);
+    std::sort(rows.begin(), rows.end(),
+              [](const std::pair<double, std::complex<double> > &a,
+                 const std::pair<double, std::complex<double> > &b) {
+                return a.first < b.first;
+              });
+    omega_.clear();
+    index_.clear();
+    for (const auto &row : rows) {
+      omega_.push_back(row.first);
+      index_.push_back(row.second);
+    }
+  }  // end of void TabulatedMaterial::Read()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::complex<double> TabulatedMaterial::GetEpsilon(double omega) const {
+    if (omega_.empty() || omega < omega_.front() || omega > omega_.back())
+      throw std::invalid_argument("Frequency is out of tabulated range!");
+    if (omega == omega_.back()) return index_.back()*index_.back();
+    long k = std::upper_bound(omega_.begin(), omega_.end(), omega)    // NOLINT
+        - omega_.begin();
+    double t = (omega - omega_[k-1])/(omega_[k] - omega_[k-1]);
+    std::complex<double> index = index_[k-1] + t*(index_[k] - index_[k-1]);
+    return index*index;
+  }  // end of std::complex<double> TabulatedMaterial::GetEpsilon()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void IndexTable::Init(const Material &material, double from_omega,
+                        double to_omega, long samples) {               // NOLINT
+    if (samples < 1 || to_omega < from_omega
+        || (samples == 1 && to_omega > from_omega))
+      throw std::invalid_argument("Wrong index table grid!");
+    material_ = &material;
+    from_omega_ = from_omega;
+    step_ = samples > 1 ? (to_omega - from_omega)/(samples - 1) : 0.0;
+    index_.resize(samples);
+    for (long k = 0; k < samples; ++k)                                 // NOLINT
+      index_[k] = material.GetIndex(GetOmega(k));
+  }  // end of void IndexTable::Init()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  std::complex<double> IndexTable::GetIndex(double omega) const {
+    if (material_ == nullptr)
+      throw std::invalid_argument("Index table is not initialized!");
+    if (!(step_ > 0.0)) {
+      if (omega == from_omega_) return index_.front();
+      return material_->GetIndex(omega);
+    }
+    double position = (omega - from_omega_)/step_;
+    const long last = index_.size() - 1;                               // NOLINT
+    // Frequencies computed as omega/omega_0*omega_0 are off the node by
+    // rounding error only.
+    const double kNodeTolerance = 1e-9;
+    if (position < -kNodeTolerance || position > last + kNodeTolerance)
+      return material_->GetIndex(omega);
+    long k = std::lround(position);                                    // NOLINT
+    if (std::abs(position - k) < kNodeTolerance) return index_[k];
+    k = static_cast<long>(std::floor(position));                       // NOLINT
+    double t = position - k;
+    return index_[k] + t*(index_[k+1] - index_[k]);
+  }  // end of std::complex<double> IndexTable::GetIndex()
+}  // end of namespace material
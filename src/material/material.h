@@ -0,0 +1,114 @@
+#ifndef SRC_MATERIAL_MATERIAL_H_
+#define SRC_MATERIAL_MATERIAL_H_
+///
+/// @file   material.h
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// material is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// material is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with material.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Dispersive materials (constant, Drude, Lorentz and
+/// tabulated) and tables of their refractive index precomputed on a
+/// frequency grid. Frequency is angular frequency in rad/s.
+///
+#include <complex>
+#include <string>
+#include <vector>
+namespace material {
+  const double kPi = 3.14159265358979323846;
+  const double kSpeedOfLight = 299792458;
+  // ********************************************************************** //
+  /// @brief Complex permittivity as a function of frequency.
+  class Material {
+   public:
+    virtual ~Material() {}
+    virtual std::complex<double> GetEpsilon(double omega) const = 0;
+    std::complex<double> GetIndex(double omega) const {
+      return std::sqrt(GetEpsilon(omega));
+    }
+  };  // end of class Material
+  // ********************************************************************** //
+  class ConstantMaterial : public Material {
+   public:
+    explicit ConstantMaterial(std::complex<double> epsilon)
+        : epsilon_(epsilon) {}
+    std::complex<double> GetEpsilon(double /*omega*/) const {return epsilon_;}
+   private:
+    std::complex<double> epsilon_;
+  };  // end of class ConstantMaterial
+  // ********************************************************************** //
+  /// @brief epsilon = epsilon_infinity + sum of oscillators
+  /// omega_p^2/(omega_0^2 - omega^2 - i gamma omega).
+  class LorentzMaterial : public Material {
+   public:
+    explicit LorentzMaterial(double epsilon_infinity)
+        : epsilon_infinity_(epsilon_infinity) {}
+    void AddOscillator(double omega_p, double omega_0, double gamma);
+    std::complex<double> GetEpsilon(double omega) const;
+   private:
+    double epsilon_infinity_;
+    struct Oscillator {double omega_p2, omega_02, gamma;};
+    std::vector<Oscillator> oscillators_;
+  };  // end of class LorentzMaterial
+  // ********************************************************************** //
+  /// @brief Lorentz oscillator with zero resonance frequency,
+  /// epsilon = epsilon_infinity - omega_p^2/(omega (omega + i gamma)).
+  class DrudeMaterial : public LorentzMaterial {
+   public:
+    DrudeMaterial(double epsilon_infinity, double omega_p, double gamma)
+        : LorentzMaterial(epsilon_infinity) {
+      AddOscillator(omega_p, 0.0, gamma);
+    }
+  };  // end of class DrudeMaterial
+  // ********************************************************************** //
+  /// @brief Experimental data, refractive index is linearly
+  /// interpolated between tabulated frequencies.
+  class TabulatedMaterial : public Material {
+   public:
+    /// @brief Read text file with (wavelength, n, k) rows, wavelength
+    /// is in units of wavelength_unit meters, lines starting with '#'
+    /// are comments.
+    void Read(std::string file_name, double wavelength_unit);
+    std::complex<double> GetEpsilon(double omega) const;
+   private:
+    /// @brief Ascending frequencies and indexes for them.
+    std::vector<double> omega_;
+    std::vector< std::complex<double> > index_;
+  };  // end of class TabulatedMaterial
+  // ********************************************************************** //
+  /// @brief Refractive index of a material precomputed on uniform
+  /// frequency grid. Frequencies at grid nodes get the stored value,
+  /// other frequencies in grid range are linearly interpolated, out of
+  /// range ones are evaluated by material. Should be initialized
+  /// before use from several threads, material should outlive table.
+  class IndexTable {
+   public:
+    void Init(const Material &material, double from_omega, double to_omega,
+              long samples);                                           // NOLINT
+    long GetSize() const {return index_.size();}                       // NOLINT
+    double GetOmega(long k) const {return from_omega_ + step_*k;}      // NOLINT
+    const std::complex<double>& GetIndexAt(long k) const {             // NOLINT
+      return index_[k];
+    }
+    const std::vector< std::complex<double> >& GetIndexes() const {
+      return index_;
+    }
+    std::complex<double> GetIndex(double omega) const;
+   private:
+    const Material *material_ = nullptr;
+    double from_omega_ = 0.0, step_ = 0.0;
+    std::vector< std::complex<double> > index_;
+  };  // end of class IndexTable
+}  // end of namespace material
+#endif  // SRC_MATERIAL_MATERIAL_H_
@@ -0,0 +1,186 @@
+#ifndef SRC_MIE_BATCH_MIE_BATCH_KERNEL_H_
+#define SRC_MIE_BATCH_MIE_BATCH_KERNEL_H_
+///
+/// @file   mie-batch-kernel.h
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// mie-batch is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// mie-batch is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with mie-batch.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Efficiencies of a single target, shared by host and device
+/// code, so no std:: containers or std::complex here. Layers are
+/// processed one by one, a target needs four buffers of kMaxTerms + 1
+/// complex values.
+///
+#include <cmath>
+#include "./mie-batch.h"
+#if defined(__CUDACC__) || defined(__HIPCC__)
+#define JADE_HOST_DEVICE __host__ __device__
+#else
+#define JADE_HOST_DEVICE
+#endif
+namespace mie_batch {
+  struct Complex {
+    double re, im;
+  };  // end of struct Complex
+  JADE_HOST_DEVICE inline Complex operator+(Complex a, Complex b) {
+    return {a.re + b.re, a.im + b.im};
+  }
+  JADE_HOST_DEVICE inline Complex operator-(Complex a, Complex b) {
+    return {a.re - b.re, a.im - b.im};
+  }
+  JADE_HOST_DEVICE inline Complex operator*(Complex a, Complex b) {
+    return {a.re*b.re - a.im*b.im, a.re*b.im + a.im*b.re};
+  }
+  JADE_HOST_DEVICE inline Complex operator*(double a, Complex b) {
+    return {a*b.re, a*b.im};
+  }
+  JADE_HOST_DEVICE inline Complex operator+(double a, Complex b) {
+    return {a + b.re, b.im};
+  }
+  JADE_HOST_DEVICE inline Complex operator-(double a, Complex b) {
+    return {a - b.re, -b.im};
+  }
+  /// @brief Smith's algorithm, avoids overflow of |b|^2.
+  JADE_HOST_DEVICE inline Complex operator/(Complex a, Complex b) {
+    if (fabs(b.re) >= fabs(b.im)) {
+      double r = b.im/b.re, d = b.re + b.im*r;
+      return {(a.re + a.im*r)/d, (a.im - a.re*r)/d};
+    }
+    double r = b.re/b.im, d = b.re*r + b.im;
+    return {(a.re*r + a.im)/d, (a.im*r - a.re)/d};
+  }
+  JADE_HOST_DEVICE inline Complex operator/(double a, Complex b) {
+    return Complex{a, 0.0}/b;
+  }
+  JADE_HOST_DEVICE inline double Norm(Complex a) {
+    return a.re*a.re + a.im*a.im;
+  }
+  /// @brief exp(2iz)
+  JADE_HOST_DEVICE inline Complex Exp2i(Complex z) {
+    double modulus = exp(-2.0*z.im);
+    return {modulus*cos(2.0*z.re), modulus*sin(2.0*z.re)};
+  }
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Number of terms from Pena-Pal paper.
+  JADE_HOST_DEVICE inline int GetTermsNumber(const Target &target) {
+    const int last = target.layers - 1;
+    const double x = target.size_parameter[last];
+    int terms = static_cast<int>(round(x + 4.05*cbrt(x) + 2.0));
+    for (int l = 0; l < target.layers; ++l) {
+      const Complex index = {target.index_re[l], target.index_im[l]};
+      const double modulus = sqrt(Norm(index));
+      int inner = static_cast<int>(round(
+          modulus*target.size_parameter[l]));
+      if (inner > terms) terms = inner;
+      if (l > 0) {
+        inner = static_cast<int>(round(
+            modulus*target.size_parameter[l-1]));
+        if (inner > terms) terms = inner;
+      }
+    }
+    return terms + 15;
+  }
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Logarithmic derivative D1_n(z) for n = 0..terms by downward
+  /// recurrence started well above terms.
+  JADE_HOST_DEVICE inline void GetD1(Complex z, int terms, Complex *D1) {
+    const int start = terms + 16 + static_cast<int>(sqrt(Norm(z)));
+    Complex d = {0.0, 0.0};
+    for (int n = start; n > terms; --n) {
+      Complex n_z = static_cast<double>(n)/z;
+      d = n_z - 1.0/(d + n_z);
+    }
+    D1[terms] = d;
+    for (int n = terms; n > 0; --n) {
+      Complex n_z = static_cast<double>(n)/z;
+      D1[n-1] = n_z - 1.0/(D1[n] + n_z);
+    }
+  }
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  /// @brief Buffers should have kMaxTerms + 1 values, returns NaN
+  /// efficiencies if target needs more terms.
+  JADE_HOST_DEVICE inline Efficiency GetEfficiency(
+      const Target &target, Complex *D1a, Complex *D1b, Complex *Ha,
+      Complex *Hb) {
+    const double kNaN = nan("");
+    const int terms = target.max_terms > 0 ? target.max_terms
+        : GetTermsNumber(target);
+    if (terms > kMaxTerms) return {kNaN, kNaN};
+    const Complex kI = {0.0, 1.0};
+    Complex index = {target.index_re[0], target.index_im[0]};
+    // Core layer.
+    GetD1(index*Complex{target.size_parameter[0], 0.0}, terms, Ha);
+    for (int n = 1; n <= terms; ++n) Hb[n] = Ha[n];
+    for (int l = 1; l < target.layers; ++l) {
+      const Complex previous_index = index;
+      index = {target.index_re[l], target.index_im[l]};
+      const double x1 = target.size_parameter[l-1],
+          x2 = target.size_parameter[l];
+      const Complex z1 = index*Complex{x1, 0.0}, z2 = index*Complex{x2, 0.0};
+      GetD1(z1, terms, D1a);
+      GetD1(z2, terms, D1b);
+      Complex D3a = kI, D3b = kI;
+      Complex psi_zeta_a = 0.5*(1.0 - Exp2i(z1)),
+          psi_zeta_b = 0.5*(1.0 - Exp2i(z2));
+      // Ratio of psi_0/zeta_0 at z1 and z2 without exp(-2iz) overflow.
+      Complex Q = Exp2i(z2 - z1)*(Exp2i(z1) - Complex{1.0, 0.0})
+          /(Exp2i(z2) - Complex{1.0, 0.0});
+      const double ratio2 = (x1/x2)*(x1/x2);
+      for (int n = 1; n <= terms; ++n) {
+        const double nd = static_cast<double>(n);
+        Q = ratio2*Q*((z2*D1b[n] + Complex{nd, 0.0})*(nd - z2*D3b))
+            /((z1*D1a[n] + Complex{nd, 0.0})*(nd - z1*D3a));
+        psi_zeta_a = psi_zeta_a*(nd/z1 - D1a[n-1])*(nd/z1 - D3a);
+        psi_zeta_b = psi_zeta_b*(nd/z2 - D1b[n-1])*(nd/z2 - D3b);
+        D3a = D1a[n] + kI/psi_zeta_a;
+        D3b = D1b[n] + kI/psi_zeta_b;
+        Complex G1 = index*Ha[n] - previous_index*D1a[n],
+            G2 = index*Ha[n] - previous_index*D3a;
+        Ha[n] = (G2*D1b[n] - Q*G1*D3b)/(G2 - Q*G1);
+        G1 = previous_index*Hb[n] - index*D1a[n];
+        G2 = previous_index*Hb[n] - index*D3a;
+        Hb[n] = (G2*D1b[n] - Q*G1*D3b)/(G2 - Q*G1);
+      }
+    }
+    // Outer boundary, host medium has unit index.
+    const double x = target.size_parameter[target.layers - 1];
+    const Complex z = {x, 0.0};
+    GetD1(z, terms, D1a);
+    Complex psi = {sin(x), 0.0}, zeta = {sin(x), -cos(x)}, D3 = kI;
+    double extinction = 0.0, scattering = 0.0;
+    for (int n = 1; n <= terms; ++n) {
+      const double nd = static_cast<double>(n);
+      const Complex n_z = nd/z;
+      const Complex previous_psi = psi, previous_zeta = zeta;
+      psi = psi*(n_z - D1a[n-1]);
+      zeta = zeta*(n_z - D3);
+      D3 = D1a[n] + kI/(psi*zeta);
+      const Complex Ga = Ha[n]/index + n_z, Gb = index*Hb[n] + n_z;
+      const Complex a = (Ga*psi - previous_psi)/(Ga*zeta - previous_zeta);
+      const Complex b = (Gb*psi - previous_psi)/(Gb*zeta - previous_zeta);
+      extinction += (2.0*nd + 1.0)*(a.re + b.re);
+      scattering += (2.0*nd + 1.0)*(Norm(a) + Norm(b));
+    }
+    const double norm = 2.0/(x*x);
+    return {norm*scattering, norm*(extinction - scattering)};
+  }  // end of Efficiency GetEfficiency()
+}  // end of namespace mie_batch
+#endif  // SRC_MIE_BATCH_MIE_BATCH_KERNEL_H_
@@ -0,0 +1,46 @@
+///
+/// @file   mie-batch.cc
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// mie-batch is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// mie-batch is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with mie-batch.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Host evaluation of batches, used when built without device
+/// support and as a reference for device results.
+///
+#include <stdexcept>
+#include <vector>
+#include "./mie-batch.h"
+#include "./mie-batch-kernel.h"
+namespace mie_batch {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void RunBatch(const std::vector<Target> &targets,
+                std::vector<Efficiency> *efficiency) {
+    for (const auto &target : targets)
+      if (target.layers < 1 || target.layers > kMaxLayers)
+        throw std::invalid_argument("Wrong number of layers in Mie batch!");
+    efficiency->resize(targets.size());
+    std::vector<Complex> buffers(4*(kMaxTerms + 1));
+    Complex *D1a = &buffers[0], *D1b = D1a + kMaxTerms + 1,
+        *Ha = D1b + kMaxTerms + 1, *Hb = Ha + kMaxTerms + 1;
+    for (unsigned i = 0; i < targets.size(); ++i)
+      (*efficiency)[i] = GetEfficiency(targets[i], D1a, D1b, Ha, Hb);
+  }  // end of void RunBatch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool IsDevice() {return false;}
+}  // end of namespace mie_batch
@@ -0,0 +1,95 @@
+///
+/// @file   mie-batch.cu
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// mie-batch is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// mie-batch is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with mie-batch.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Device evaluation of batches, one thread for each target.
+/// Compiled as CUDA or as HIP source.
+///
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef __HIPCC__
+#include <hip/hip_runtime.h>
+#define cudaError_t hipError_t
+#define cudaSuccess hipSuccess
+#define cudaGetErrorString hipGetErrorString
+#define cudaGetLastError hipGetLastError
+#define cudaMalloc hipMalloc
+#define cudaFree hipFree
+#define cudaMemcpy hipMemcpy
+#define cudaMemcpyHostToDevice hipMemcpyHostToDevice
+#define cudaMemcpyDeviceToHost hipMemcpyDeviceToHost
+#define cudaDeviceSynchronize hipDeviceSynchronize
+#else
+#include <cuda_runtime.h>
+#endif
+#include "./mie-batch.h"
+#include "./mie-batch-kernel.h"
+namespace mie_batch {
+  namespace {
+    const int kBlockSize = 64;
+    // Device buffers are kept between batches and grow as needed.
+    Target *device_targets_ = nullptr;
+    Efficiency *device_efficiency_ = nullptr;
+    unsigned long device_size_ = 0;                                    // NOLINT
+    void Check(cudaError_t status, const char *action) {
+      if (status != cudaSuccess)
+        throw std::runtime_error(std::string("Mie batch ") + action + ": "
+                                 + cudaGetErrorString(status));
+    }
+    __global__ void EvaluateTargets(const Target *targets, int size,
+                                    Efficiency *efficiency) {
+      const int i = blockIdx.x*blockDim.x + threadIdx.x;
+      if (i >= size) return;
+      Complex D1a[kMaxTerms + 1], D1b[kMaxTerms + 1],
+          Ha[kMaxTerms + 1], Hb[kMaxTerms + 1];
+      efficiency[i] = GetEfficiency(targets[i], D1a, D1b, Ha, Hb);
+    }
+  }  // end of anonymous namespace
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void RunBatch(const std::vector<Target> &targets,
+                std::vector<Efficiency> *efficiency) {
+    for (const auto &target : targets)
+      if (target.layers < 1 || target.layers > kMaxLayers)
+        throw std::invalid_argument("Wrong number of layers in Mie batch!");
+    const int size = targets.size();
+    efficiency->resize(size);
+    if (size == 0) return;
+    if (targets.size() > device_size_) {
+      Check(cudaFree(device_targets_), "free");
+      Check(cudaFree(device_efficiency_), "free");
+      Check(cudaMalloc(reinterpret_cast<void**>(&device_targets_),
+                       size*sizeof(Target)), "malloc");
+      Check(cudaMalloc(reinterpret_cast<void**>(&device_efficiency_),
+                       size*sizeof(Efficiency)), "malloc");
+      device_size_ = size;
+    }
+    Check(cudaMemcpy(device_targets_, targets.data(), size*sizeof(Target),
+                     cudaMemcpyHostToDevice), "copy");
+    EvaluateTargets<<<(size + kBlockSize - 1)/kBlockSize, kBlockSize>>>(
+        device_targets_, size, device_efficiency_);
+    Check(cudaGetLastError(), "launch");
+    Check(cudaMemcpy(efficiency->data(), device_efficiency_,
+                     size*sizeof(Efficiency), cudaMemcpyDeviceToHost), "copy");
+  }  // end of void RunBatch()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool IsDevice() {return true;}
+}  // end of namespace mie_batch
@@ -0,0 +1,61 @@
+#ifndef SRC_MIE_BATCH_MIE_BATCH_H_
+#define SRC_MIE_BATCH_MIE_BATCH_H_
+///
+/// @file   mie-batch.h
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// mie-batch is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// mie-batch is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with mie-batch.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Efficiencies of a batch of independent multilayer spheres
+/// evaluated with a single kernel launch on CUDA or HIP device (if
+/// built with JADE_MIE_BATCH_CUDA or JADE_MIE_BATCH_HIP CMake option)
+/// or on host otherwise. Algorithm is from O. Pena and U. Pal,
+/// 'Scattering of electromagnetic radiation by a multilayered sphere',
+/// Computer Physics Communications, vol. 180, Nov. 2009, pp. 2348-2354.
+///
+#include <vector>
+namespace mie_batch {
+  const int kMaxLayers = 10;
+  /// @brief Size of per target buffers, targets needing more terms
+  /// fail.
+  const int kMaxTerms = 256;
+  // ********************************************************************** //
+  /// @brief Layers from the core outwards, size parameter of a layer
+  /// is 2 pi n_host r / lambda of its outer radius, index is relative
+  /// to the host medium.
+  struct Target {
+    int layers = 0;
+    /// @brief Number of multipole terms, zero or negative uses
+    /// Pena-Pal value.
+    int max_terms = 0;
+    double size_parameter[kMaxLayers];
+    double index_re[kMaxLayers], index_im[kMaxLayers];
+  };  // end of struct Target
+  // ********************************************************************** //
+  /// @brief NaN for failed targets.
+  struct Efficiency {
+    double Qsca, Qabs;
+  };  // end of struct Efficiency
+  // ********************************************************************** //
+  /// @brief Evaluate all targets, efficiency is resized to their
+  /// number. Throws std::invalid_argument for wrong targets and
+  /// std::runtime_error for device errors. Should be called from a
+  /// single thread.
+  void RunBatch(const std::vector<Target> &targets,
+                std::vector<Efficiency> *efficiency);
+  /// @brief True if batches are evaluated on device.
+  bool IsDevice();
+}  // end of namespace mie_batch
+#endif  // SRC_MIE_BATCH_MIE_BATCH_H_
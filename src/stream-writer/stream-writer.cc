@@ -0,0 +1,128 @@
+///
+/// @file   stream-writer.cc
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// stream-writer is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// stream-writer is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with stream-writer.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Background writer of chunked data.
+///
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./stream-writer.h"
+namespace stream_writer {
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void StreamWriter::Open(const std::string &file_name, bool isAppend,
+                          std::size_t chunk_size, std::size_t ring_size) {
+    Close();
+    if (chunk_size == 0 || ring_size == 0)
+      throw std::invalid_argument("Wrong stream chunks!");
+    file_ = std::fopen(file_name.c_str(), isAppend ? "ab" : "wb");
+    if (file_ == nullptr)
+      throw std::invalid_argument("Can not open " + file_name);
+    chunk_size_ = chunk_size;
+    chunk_.clear();
+    chunk_.reserve(chunk_size_);
+    ring_.assign(ring_size, std::vector<char>());
+    head_ = 0;
+    tail_ = 0;
+    isClosing_ = false;
+    isFailed_ = false;
+    writer_ = std::thread(&StreamWriter::RunWriter, this);
+  }  // end of void StreamWriter::Open()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void StreamWriter::Write(const void *data, std::size_t size) {
+    if (!IsOpen()) throw std::invalid_argument("Stream is not open!");
+    const char *bytes = static_cast<const char*>(data);
+    chunk_.insert(chunk_.end(), bytes, bytes + size);
+    if (chunk_.size() >= chunk_size_) HandOff(false);
+  }  // end of void StreamWriter::Write()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void StreamWriter::Flush() {
+    if (IsOpen()) HandOff(false);
+  }  // end of void StreamWriter::Flush()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  bool StreamWriter::Close() {
+    if (!IsOpen()) return !isFailed_;
+    HandOff(true);
+    isClosing_ = true;
+    {
+      // Writer checks isClosing_ under the lock, so it can not miss it.
+      std::lock_guard<std::mutex> lock(mutex_);
+    }
+    is_ready_.notify_one();
+    writer_.join();
+    if (std::fclose(file_) != 0) isFailed_ = true;
+    file_ = nullptr;
+    std::vector<char>().swap(chunk_);
+    ring_.clear();
+    return !isFailed_;
+  }  // end of bool StreamWriter::Close()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // Swap the current chunk with a free slot of the ring, it gets the
+  // memory of a written chunk back.
+  void StreamWriter::HandOff(bool isWaiting) {
+    if (chunk_.empty()) return;
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    while (tail - head_.load(std::memory_order_acquire) >= ring_.size()) {
+      if (!isWaiting) return;
+      is_ready_.notify_one();
+      std::this_thread::yield();
+    }
+    ring_[tail % ring_.size()].swap(chunk_);
+    chunk_.clear();
+    tail_.store(tail + 1, std::memory_order_release);
+    is_ready_.notify_one();
+  }  // end of void StreamWriter::HandOff()
+  // ********************************************************************** //
+  // ********************************************************************** //
+  // ********************************************************************** //
+  void StreamWriter::RunWriter() {
+    while (true) {
+      const std::size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load(std::memory_order_acquire)) {
+        // Hand off does not lock the mutex, so notification may come
+        // before the wait, the timeout bounds the delay.
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (isClosing_ && head == tail_.load(std::memory_order_acquire))
+          break;
+        is_ready_.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+            return isClosing_ || head != tail_.load(std::memory_order_acquire);
+          });
+        continue;
+      }
+      std::vector<char> &slot = ring_[head % ring_.size()];
+      if (std::fwrite(slot.data(), 1, slot.size(), file_) != slot.size())
+        isFailed_ = true;
+      slot.clear();
+      head_.store(head + 1, std::memory_order_release);
+      // Data becomes visible to readers once writer catches up.
+      if (head + 1 == tail_.load(std::memory_order_acquire)) std::fflush(file_);
+    }
+  }  // end of void StreamWriter::RunWriter()
+}  // end of namespace stream_writer
@@ -0,0 +1,78 @@
+#ifndef SRC_STREAM_WRITER_STREAM_WRITER_H_
+#define SRC_STREAM_WRITER_STREAM_WRITER_H_
+///
+/// @file   stream-writer.h
+/// @author Ladutenko Konstantin <kostyfisik at gmail (.) com>
+/// @copyright 2015 Ladutenko Konstantin
+///
+/// stream-writer is free software: you can redistribute it and/or modify
+/// it under the terms of the GNU General Public License as published by
+/// the Free Software Foundation, either version 3 of the License, or
+/// (at your option) any later version.
+///
+/// stream-writer is distributed in the hope that it will be useful,
+/// but WITHOUT ANY WARRANTY; without even the implied warranty of
+/// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/// GNU General Public License for more details.
+///
+/// You should have received a copy of the GNU General Public License
+/// along with stream-writer.  If not, see <http://www.gnu.org/licenses/>.
+///
+/// @brief Appends data to a file from a background thread, so that
+/// the producer never waits for disk. Data is collected in chunks,
+/// full chunks are handed to the writing thread through a lock-free
+/// single producer single consumer ring.
+///
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+namespace stream_writer {
+  class StreamWriter {
+   public:
+    StreamWriter() = default;
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+    ~StreamWriter() {Close();}
+    /// @brief Create (or truncate) file and start writing thread,
+    /// throws std::invalid_argument if file can not be opened. Chunks
+    /// of chunk_size bytes are handed off, at most ring_size of them
+    /// wait for disk. If the ring is full data is collected in the
+    /// current chunk, so memory grows only while disk lags behind.
+    void Open(const std::string &file_name, bool isAppend = false,
+              std::size_t chunk_size = 1 << 20, std::size_t ring_size = 8);
+    bool IsOpen() const {return file_ != nullptr;}
+    /// @brief Should be called from a single thread.
+    void Write(const void *data, std::size_t size);
+    void Write(const std::string &text) {Write(text.data(), text.size());}
+    void Write(const std::vector<double> &values) {
+      Write(values.data(), values.size()*sizeof(double));
+    }
+    /// @brief Hand off the current chunk even if it is not full.
+    void Flush();
+    /// @brief Write all data and close file, returns false if some
+    /// write has failed.
+    bool Close();
+   private:
+    void HandOff(bool isWaiting);
+    void RunWriter();
+    std::FILE *file_ = nullptr;
+    std::size_t chunk_size_ = 0;
+    std::vector<char> chunk_;
+    /// @brief Chunk slots, written slots are cleared and keep their
+    /// memory for the next chunks.
+    std::vector< std::vector<char> > ring_;
+    /// @brief Slots [head_, tail_) are waiting for disk, head_ is
+    /// advanced by writer only and tail_ by producer only.
+    std::atomic<std::size_t> head_{0}, tail_{0};
+    std::atomic<bool> isClosing_{false}, isFailed_{false};
+    /// @brief Only for sleeping writer, hand off does not lock it.
+    std::mutex mutex_;
+    std::condition_variable is_ready_;
+    std::thread writer_;
+  };  // end of class StreamWriter
+}  // end of namespace stream_writer
+#endif  // SRC_STREAM_WRITER_STREAM_WRITER_H_